@@ -1,14 +1,10 @@
 defmodule DemoVGG16 do
   use NNInterp,
     model: "./model/vgg16-7.onnx",
-    url: "https://github.com/shoz-f/nn-interp/releases/download/0.1.0/vgg16-7.onnx"
+    url: "https://github.com/shoz-f/nn-interp/releases/download/0.1.0/vgg16-7.onnx",
+    label: "./imagenet1000.label"
 
   @vgg16_shape {224, 224}
-  @imagenet1000 (for item <- File.stream!("./imagenet1000.label") do
-                    String.trim_trailing(item)
-                  end)
-                  |> Enum.with_index(&{&2, &1})
-                  |> Enum.into(%{})
 
   def apply(img, top) do
     # preprocess
@@ -17,18 +13,13 @@ defmodule DemoVGG16 do
       |> CImg.to_binary([{:range, {-2.2, 2.7}}, :nchw])
 
     # prediction
-    outputs = __MODULE__
-      |> NNInterp.set_input_tensor(0, bin)
-      |> NNInterp.invoke()
-      |> NNInterp.get_output_tensor(0)
-      |> Nx.from_binary({:f, 32}) |> Nx.reshape({1000})
+    __MODULE__
+    |> NNInterp.set_input_tensor(0, bin)
+    |> NNInterp.invoke()
 
     # postprocess
-    outputs
-    |> Nx.argsort(direction: :desc)
-    |> Nx.slice([0], [top])
-    |> Nx.to_flat_list()
-    |> Enum.map(&@imagenet1000[&1])
+    {:ok, [result]} = NNInterp.topk(__MODULE__, 0, k: top)
+    Enum.map(result, fn [label, _index, _score] -> label end)
   end
   
   def run() do
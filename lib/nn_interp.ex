@@ -69,7 +69,7 @@ defmodule NNInterp do
   @model_suffix suffix[@framework]
 
   # session record
-  defstruct module: nil, inputs: [], outputs: []
+  defstruct module: nil, method: nil, inputs: [], outputs: []
 
   defmacro __using__(opts) do
     quote generated: true, location: :keep do
@@ -87,9 +87,13 @@ defmodule NNInterp do
         nn_inputs  = Keyword.get(opts, :inputs, [])
         nn_outputs = Keyword.get(opts, :outputs, [])
         nn_opts    = Keyword.get(opts, :opts, "")
+        nn_tokenizer = case Keyword.get(opts, :tokenizer) do
+          nil  -> []
+          spec -> ["--tokenizer", spec]
+        end
 
         port = Port.open({:spawn_executable, executable}, [
-          {:args, String.split(nn_opts) ++ opt_tspecs("--inputs", nn_inputs) ++ opt_tspecs("--outputs", nn_outputs) ++ [nn_model, nn_label]},
+          {:args, String.split(nn_opts) ++ nn_tokenizer ++ opt_tspecs("--inputs", nn_inputs) ++ opt_tspecs("--outputs", nn_outputs) ++ [nn_model, nn_label]},
           {:packet, 4},
           :binary
         ])
@@ -97,8 +101,8 @@ defmodule NNInterp do
         {:ok, %{port: port, itempl: nn_inputs, otempl: nn_outputs}}
       end
 
-      def session() do
-        %NNInterp{module: __MODULE__}
+      def session(method \\ nil) do
+        %NNInterp{module: __MODULE__, method: method}
       end
 
       def handle_call(cmd_line, _from, state) when is_binary(cmd_line) do
@@ -111,6 +115,12 @@ defmodule NNInterp do
         {:reply, response, state}
       end
 
+      # the partial results before the reply are sent to pid as {:partial, data}
+      def handle_call({:stream, cmd_line, pid}, _from, state) do
+        Port.command(state.port, cmd_line)
+        {:reply, stream_loop(state.port, pid), state}
+      end
+
       def handle_call({:itempl, index}, _from, %{itempl: template}=state) do
         {:reply, {:ok, Enum.at(template, index)}, state}
       end
@@ -119,15 +129,33 @@ defmodule NNInterp do
         {:reply, {:ok, Enum.at(template, index)}, state}
       end
 
+      defp stream_loop(port, pid) do
+        receive do
+          {^port, {:data, <<"{\"partial\":", _::binary>>=partial}} ->
+            {:ok, %{"partial" => data}} = Poison.decode(partial)
+            send(pid, {:partial, data})
+            stream_loop(port, pid)
+          {^port, {:data, <<result::binary>>}} ->
+            {:ok, result}
+        after
+          Keyword.get(unquote(opts), :timeout, 300000) -> {:timeout}
+        end
+      end
+
       def terminate(_reason, state) do
         Port.close(state.port)
       end
 
       defp opt_tspecs(_, []), do: []
+      defp opt_tspecs(opt_name, [{_, tspecs}|_]=methods) when is_list(tspecs) do
+        [opt_name, Enum.map(methods, fn {name, tspecs} -> "#{name}=" <> tspecs2str(tspecs) end) |> Enum.join(";")]
+      end
       defp opt_tspecs(opt_name, tspecs) do
-        [opt_name, Enum.map(tspecs, &tspec2str/1) |> Enum.join(":")]
+        [opt_name, tspecs2str(tspecs)]
       end
 
+      defp tspecs2str(tspecs), do: Enum.map(tspecs, &tspec2str/1) |> Enum.join(":")
+
       defp tspec2str({:skip, _}), do: ""
       defp tspec2str({dtype, shape}) do
         dtype = Atom.to_string(dtype)
@@ -206,6 +234,29 @@ defmodule NNInterp do
     GenServer.stop(mod)
   end
 
+  @doc """
+  Select the method of the model to which the following set_input_tensor,
+  invoke and get_output_tensor are applied.
+
+  The tensor specs of each method are given as a keyword list to `:inputs`
+  and `:outputs`, ex. `inputs: [encode_image: [f32: {1,3,224,224}], encode_text: [i32: {1,77}]]`.
+
+  ## Parameters
+
+    * mod  - modules' names
+    * name - name of the method
+  """
+  def select_method(mod, name) when is_atom(mod) do
+    cmd  = 6
+    name = to_string(name)
+    size = byte_size(name)
+    case GenServer.call(mod, <<cmd::little-integer-32, size::little-integer-32>> <> name, @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
   @doc """
   Put a flat binary to the input tensor on the interpreter.
 
@@ -215,6 +266,13 @@ defmodule NNInterp do
     * index - index of input tensor in the model
     * bin   - input data - flat binary, cf. serialized tensor
     * opts  - data conversion
+      * dtype: - type of `bin`
+         * "none" - as it is
+         * "<f4"  - uint8 data, converted to float32 in `range:`
+         * "<f2"  - float16 data, widened to float32 unless the tensor is float16
+      * range: - {lo, hi} range of the converted float32 (default {0.0, 1.0})
+      * gauss: - {{mean, std}, ..} per-channel normalization of "<f4" in place of `range:`
+      * layout: - :nchw(default) or :nhwc, the channel axis for `gauss:`
   """
   def set_input_tensor(mod, index, bin, opts \\ [])
 
@@ -234,9 +292,27 @@ defmodule NNInterp do
   defp input_tensor(index, bin, opts) do
     dtype = case Keyword.get(opts, :dtype, "none") do
       "none" -> 0
-      "<f4"  -> 1
+      "<f4"  -> if Keyword.has_key?(opts, :gauss), do: 3, else: 1
       "<f2"  -> 2
     end
+    input_tensor(dtype, index, bin, opts)
+  end
+
+  defp input_tensor(3, index, bin, opts) do
+    gauss    = Keyword.get(opts, :gauss) |> Tuple.to_list()
+    channels = Enum.count(gauss)
+    layout   = case Keyword.get(opts, :layout, :nchw) do
+      :nchw -> 0
+      :nhwc -> 1
+    end
+    params = for {mean, std} <- gauss, into: "", do: <<mean::little-float-32, std::little-float-32>>
+
+    size = 16 + byte_size(params) + byte_size(bin)
+
+    <<size::little-integer-32, index::little-integer-32, 3::little-integer-32, layout::little-integer-32, channels::little-integer-32>> <> params <> bin
+  end
+
+  defp input_tensor(dtype, index, bin, opts) do
     {lo, hi} = Keyword.get(opts, :range, {0.0, 1.0})
 
     size = 16 + byte_size(bin)
@@ -244,6 +320,435 @@ defmodule NNInterp do
     <<size::little-integer-32, index::little-integer-32, dtype::little-integer-32, lo::little-float-32, hi::little-float-32, bin::binary>>
   end
 
+  @doc """
+  Put a raw image to the input tensor on the interpreter.
+  The image is resized, normalized and transposed to the input tensor inside
+  the interpreter. The geometry of resizing is kept for later box mapping.
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * bin   - image data - u8 HWC binary (gray, rgb or rgba)
+    * {width, height, channels} - size of the image
+    * opts
+      * resize: - :stretch(default), :crop (center crop) or :letterbox
+      * pad:    - {r, g, b} padding color of letterbox (default {114, 114, 114})
+      * order:  - :rgb(default) or :bgr, channel order of the input tensor
+      * layout: - :nchw(default) or :nhwc
+      * range:  - {lo, hi} range of the converted float32 (default {0.0, 1.0})
+      * gauss:  - {{mean, std}, ..} per-channel normalization in place of `range:`
+  """
+  def set_input_image(mod, index, bin, shape, opts \\ [])
+
+  def set_input_image(mod, index, bin, shape, opts) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_image(index, bin, shape, opts), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_image(%NNInterp{inputs: inputs}=session, index, bin, shape, opts) do
+    %NNInterp{session | inputs: [input_image(index, bin, shape, opts) | inputs]}
+  end
+
+  defp input_image(index, bin, {width, height, channels}, opts) do
+    size = 20 + preprocess_spec_size() + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 4::little-integer-32,
+      width::little-integer-32, height::little-integer-32, channels::little-integer-32>>
+    <> preprocess_spec(opts) <> bin
+  end
+
+  @doc """
+  Put a JPEG/PNG encoded image to the input tensor on the interpreter.
+  The image is decoded asynchronously inside the interpreter (JPEG with the
+  scaled IDCT when it is much larger than the input tensor), then resized
+  and normalized as `set_input_image/5`.
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * bin   - JPEG or PNG file image
+    * opts  - same as `set_input_image/5`
+  """
+  def set_input_encoded_image(mod, index, bin, opts \\ [])
+
+  def set_input_encoded_image(mod, index, bin, opts) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_encoded_image(index, bin, opts), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_encoded_image(%NNInterp{inputs: inputs}=session, index, bin, opts) do
+    %NNInterp{session | inputs: [input_encoded_image(index, bin, opts) | inputs]}
+  end
+
+  defp input_encoded_image(index, bin, opts) do
+    size = 8 + preprocess_spec_size() + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 5::little-integer-32>>
+    <> preprocess_spec(opts) <> bin
+  end
+
+  @doc """
+  Put a camera frame (NV12, I420 or YUYV) to the input tensor on the interpreter.
+  The YUV->RGB conversion is fused into the resizing of `set_input_image/5`.
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * bin   - frame data
+    * {format, width, height} - format is :nv12, :i420 or :yuyv
+    * opts  - same as `set_input_image/5` and
+      * stride: - bytes per row of the Y plane (YUYV: packed row), default tight.
+                  NV12 uses it also for the UV plane, so it is at least the width rounded up to even
+      * matrix: - :bt601(default) or :bt709
+  """
+  def set_input_yuv(mod, index, bin, shape, opts \\ [])
+
+  def set_input_yuv(mod, index, bin, shape, opts) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_yuv(index, bin, shape, opts), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_yuv(%NNInterp{inputs: inputs}=session, index, bin, shape, opts) do
+    %NNInterp{session | inputs: [input_yuv(index, bin, shape, opts) | inputs]}
+  end
+
+  defp input_yuv(index, bin, {format, width, height}, opts) do
+    format = case format do
+      :nv12 -> 0
+      :i420 -> 1
+      :yuyv -> 2
+    end
+    matrix = case Keyword.get(opts, :matrix, :bt601) do
+      :bt601 -> 0
+      :bt709 -> 1
+    end
+    stride = Keyword.get(opts, :stride, 0)
+
+    size = 28 + preprocess_spec_size() + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 6::little-integer-32,
+      format::little-integer-32, matrix::little-integer-32,
+      width::little-integer-32, height::little-integer-32, stride::little-integer-32>>
+    <> preprocess_spec(opts) <> bin
+  end
+
+  @doc """
+  Put PCM audio to the input tensor on the interpreter as a log-mel spectrogram.
+  The input tensor is f32 shaped [.., n_mels, frames] (or [.., frames, n_mels]
+  with `layout: :frames_mels`).
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * bin   - PCM data (interleaved channels are averaged)
+    * opts
+      * format:      - :s16(default) or :f32
+      * channels:    - number of channels (default 1)
+      * sample_rate: - sampling rate (default 16000)
+      * n_fft:       - FFT size (default 400)
+      * hop:         - hop size (default 160)
+      * win_length:  - window length (default n_fft)
+      * n_mels:      - number of mel bins (default 80)
+      * fmin:, fmax: - frequency range of the filterbank (default 0.0, sample_rate/2)
+      * window:      - :hann(default) or :hamming
+      * mel:         - :slaney(default) or :htk
+      * power:       - 2(default, power) or 1(magnitude)
+      * log:         - :log10(default), :ln or :db
+      * eps:         - floor of the spectrum (default 1.0e-10)
+      * layout:      - :mels_frames(default) or :frames_mels
+      * center:      - reflect padding of n_fft/2 (default false)
+      * stream:      - :none(default), :append (rolling window) or :reset
+  """
+  def set_input_audio(mod, index, bin, opts \\ [])
+
+  def set_input_audio(mod, index, bin, opts) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_audio(index, bin, opts), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_audio(%NNInterp{inputs: inputs}=session, index, bin, opts) do
+    %NNInterp{session | inputs: [input_audio(index, bin, opts) | inputs]}
+  end
+
+  defp input_audio(index, bin, opts) do
+    format = case Keyword.get(opts, :format, :s16) do
+      :s16 -> 0
+      :f32 -> 1
+    end
+    channels    = Keyword.get(opts, :channels, 1)
+    sample_rate = Keyword.get(opts, :sample_rate, 16000)
+    n_fft       = Keyword.get(opts, :n_fft, 400)
+    hop         = Keyword.get(opts, :hop, 160)
+    win_length  = Keyword.get(opts, :win_length, 0)
+    n_mels      = Keyword.get(opts, :n_mels, 80)
+    fmin        = Keyword.get(opts, :fmin, 0.0)
+    fmax        = Keyword.get(opts, :fmax, 0.0)
+    window = case Keyword.get(opts, :window, :hann) do
+      :hann    -> 0
+      :hamming -> 1
+    end
+    mel = case Keyword.get(opts, :mel, :slaney) do
+      :htk    -> 0
+      :slaney -> 1
+    end
+    power = Keyword.get(opts, :power, 2)
+    log = case Keyword.get(opts, :log, :log10) do
+      :ln    -> 0
+      :log10 -> 1
+      :db    -> 2
+    end
+    eps    = Keyword.get(opts, :eps, 1.0e-10)
+    layout = case Keyword.get(opts, :layout, :mels_frames) do
+      :mels_frames -> 0
+      :frames_mels -> 1
+    end
+    center = if Keyword.get(opts, :center, false), do: 1, else: 0
+    stream = case Keyword.get(opts, :stream, :none) do
+      :none   -> 0
+      :append -> 1
+      :reset  -> 2
+    end
+
+    spec = <<format::little-integer-32, channels::little-integer-32, sample_rate::little-integer-32,
+      n_fft::little-integer-32, hop::little-integer-32, win_length::little-integer-32, n_mels::little-integer-32,
+      fmin::little-float-32, fmax::little-float-32, window::little-integer-32, mel::little-integer-32,
+      power::little-integer-32, log::little-integer-32, eps::little-float-32, layout::little-integer-32,
+      center::little-integer-32, stream::little-integer-32>>
+
+    size = 8 + byte_size(spec) + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 7::little-integer-32>> <> spec <> bin
+  end
+
+  @doc """
+  Put texts to the input tensor on the interpreter as token ids.
+  The texts are tokenized by the tokenizer given at start-up
+  (`tokenizer: "clip:<merges file>"` or `tokenizer: "wordpiece:<vocab file>"`),
+  and padded/truncated to the context length of the i32/i64 input tensor
+  [batch, context].
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * texts - a text or list of texts (UTF-8)
+    * opts
+      * mask: - index of the attention mask input tensor (default none)
+  """
+  def set_input_text(mod, index, texts, opts \\ [])
+
+  def set_input_text(mod, index, texts, opts) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_text(index, texts, opts), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_text(%NNInterp{inputs: inputs}=session, index, texts, opts) do
+    %NNInterp{session | inputs: [input_text(index, texts, opts) | inputs]}
+  end
+
+  defp input_text(index, text, opts) when is_binary(text), do: input_text(index, [text], opts)
+  defp input_text(index, texts, opts) do
+    mask  = Keyword.get(opts, :mask, -1)
+    count = Enum.count(texts)
+    bin   = for text <- texts, into: "", do: <<byte_size(text)::little-integer-32, text::binary>>
+
+    size = 16 + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 8::little-integer-32,
+      mask::little-signed-integer-32, count::little-integer-32>> <> bin
+  end
+
+  @doc """
+  Append the new samples to the sliding window of the input tensor kept on the
+  interpreter. Only a hop is sent every step; the window is the whole input tensor
+  sliding along its outermost axis longer than 1 (e.g. T of [1, T, F]), and is put
+  into the tensor at invoke. The hop must be whole steps (F values each). The window
+  starts with zeros.
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * bin   - new samples in the dtype of the input tensor, whole steps
+    * opts
+      * reset: - clear the window before appending (default false)
+
+    Setting the tensor in the other ways stops the window.
+  """
+  def set_input_stream(mod, index, bin, opts \\ [])
+
+  def set_input_stream(mod, index, bin, opts) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_stream(index, bin, opts), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_stream(%NNInterp{inputs: inputs}=session, index, bin, opts) do
+    %NNInterp{session | inputs: [input_stream(index, bin, opts) | inputs]}
+  end
+
+  defp input_stream(index, bin, opts) do
+    flags = if Keyword.get(opts, :reset, false), do: 1, else: 0
+
+    size = 12 + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 9::little-integer-32, flags::little-integer-32>> <> bin
+  end
+
+  @doc """
+  Upload a tensor once under the name. It is kept on the interpreter to be set
+  to the input tensors by set_input_stored/3 without sending it again. The least
+  recently used tensors are evicted over the capacity (`opts: "--store <MB>"`,
+  default 256MB).
+
+  ## Parameters
+
+    * mod  - modules' names
+    * name - name of the tensor
+    * bin  - binary of the tensor
+
+  ## Return
+
+    {:ok, evicted} - names of the evicted tensors
+  """
+  def store_tensor(mod, name, bin) do
+    store_call(mod, 0, name, bin)
+  end
+
+  @doc """
+  Remove the stored tensor of the name.
+  """
+  def remove_tensor(mod, name) do
+    store_call(mod, 1, name, <<>>)
+  end
+
+  defp store_call(mod, flags, name, bin) do
+    cmd = 17
+    cmd_line = <<cmd::little-integer-32, flags::little-integer-32, byte_size(bin)::little-integer-32,
+      byte_size(name)::little-integer-32>> <> name <> bin
+
+    case GenServer.call(mod, cmd_line, @timeout) do
+      {:ok, result} ->
+        case Poison.decode(result) do
+          {:ok, %{"status" => 0, "evicted" => evicted}} -> {:ok, evicted}
+          {:ok, %{"status" => 0}} -> :ok
+          {:ok, %{"status" => status}} -> {:error, status}
+          any -> any
+        end
+      any -> any
+    end
+  end
+
+  @doc """
+  Put the tensor stored by store_tensor/3 to the input tensor on the interpreter.
+
+  ## Parameters
+
+    * mod   - modules' names or session.
+    * index - index of input tensor in the model
+    * name  - name of the stored tensor
+  """
+  def set_input_stored(mod, index, name) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_stored(index, name), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def set_input_stored(%NNInterp{inputs: inputs}=session, index, name) do
+    %NNInterp{session | inputs: [input_stored(index, name) | inputs]}
+  end
+
+  defp input_stored(index, name) do
+    size = 12 + byte_size(name)
+    <<size::little-integer-32, index::little-integer-32, 10::little-integer-32, byte_size(name)::little-integer-32>> <> name
+  end
+
+  @doc """
+  Overwrite a byte range of the input tensor on the interpreter. Only the changed
+  region is sent, and the rest keeps what is set before.
+
+  ## Parameters
+
+    * mod    - modules' names or session.
+    * index  - index of input tensor in the model
+    * offset - byte offset in the input tensor
+    * bin    - new bytes
+  """
+  def patch_input_tensor(mod, index, offset, bin) when is_atom(mod) do
+    cmd = 1
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> input_patch(index, offset, bin), @timeout) do
+      {:ok, result} ->  Poison.decode(result)
+      any -> any
+    end
+    mod
+  end
+
+  def patch_input_tensor(%NNInterp{inputs: inputs}=session, index, offset, bin) do
+    %NNInterp{session | inputs: [input_patch(index, offset, bin) | inputs]}
+  end
+
+  defp input_patch(index, offset, bin) do
+    size = 12 + byte_size(bin)
+    <<size::little-integer-32, index::little-integer-32, 11::little-integer-32, offset::little-integer-32>> <> bin
+  end
+
+  defp preprocess_spec_size(), do: 40
+
+  defp preprocess_spec(opts) do
+    resize = case Keyword.get(opts, :resize, :stretch) do
+      :stretch   -> 0
+      :crop      -> 1
+      :letterbox -> 2
+    end
+    order = case Keyword.get(opts, :order, :rgb) do
+      :rgb -> 0
+      :bgr -> 1
+    end
+    layout = case Keyword.get(opts, :layout, :nchw) do
+      :nchw -> 0
+      :nhwc -> 1
+    end
+    {r, g, b} = Keyword.get(opts, :pad, {114, 114, 114})
+
+    # normalization: (x - mean)/std
+    gauss = case Keyword.get(opts, :gauss) do
+      nil ->
+        {lo, hi} = Keyword.get(opts, :range, {0.0, 1.0})
+        std = 255.0/(hi - lo)
+        List.duplicate({-lo*std, std}, 3)
+      gauss ->
+        Tuple.to_list(gauss)
+    end
+    means = for {mean, _} <- gauss, into: "", do: <<mean::little-float-32>>
+    stds  = for {_, std} <- gauss, into: "", do: <<std::little-float-32>>
+
+    <<resize::little-integer-32, order::little-integer-32, layout::little-integer-32, r, g, b, 0>> <> means <> stds
+  end
+
   @doc """
   Put flat binaries to the input tensors on the interpreter.
 
@@ -322,11 +827,20 @@ defmodule NNInterp do
     mod
   end
 
-  def invoke(%NNInterp{module: mod, inputs: inputs}=session) do
-    cmd   = 4
+  def invoke(%NNInterp{module: mod, method: method, inputs: inputs}=session) do
     count = Enum.count(inputs)
-    data  = Enum.reduce(inputs, <<>>, fn x,acc -> acc <> x end)
-    case GenServer.call(mod, <<cmd::little-integer-32, count::little-integer-32>> <> data, @timeout) do
+    data  = Enum.reverse(inputs) |> Enum.reduce(<<>>, fn x,acc -> acc <> x end)
+    cmd_line = case method do
+      nil ->
+        cmd = 4
+        <<cmd::little-integer-32, count::little-integer-32>>
+      name ->
+        cmd  = 7
+        name = to_string(name)
+        size = byte_size(name)
+        <<cmd::little-integer-32, size::little-integer-32>> <> name <> <<count::little-integer-32>>
+    end
+    case GenServer.call(mod, cmd_line <> data, @timeout) do
       {:ok, <<count::little-integer-32, results::binary>>} ->
           if count > 0 do
               outputs = for <<size::little-integer-32, tensor::binary-size(size) <- results>> do tensor end
@@ -380,9 +894,540 @@ defmodule NNInterp do
     end
   end
 
+  @doc """
+  Execute post processing: nms over a batch of images.
+
+  ## Parameters
+
+    * mod             - modules' names
+    * num_batch       - number of images
+    * num_boxes       - number of candidate boxes per image
+    * num_class       - number of category class
+    * boxes           - binaries, serialized boxes tensor[`num_batch`][`num_boxes`][4]; dtype: float32
+    * scores          - binaries, serialized score tensor[`num_batch`][`num_boxes`][`num_class`]; dtype: float32
+    * opts
+      * iou_threshold:   - IOU threshold
+      * score_threshold: - score cutoff threshold
+      * sigma:           - soft IOU parameter
+      * boxrepr:         - type of box representation (see non_max_suppression_multi_class/5)
+      * agnostic:        - suppress overlapping boxes across the classes
+      * max_candidates:  - candidates per class kept before NMS (0: all)
+      * max_detections:  - detections kept per image (0: all)
+      * method:          - :auto, :dense or :grid (uniform grid for the large candidate sets)
+      * algorithm:       - :greedy (hard/soft NMS), :fast (Fast-NMS) or :matrix (Matrix-NMS;
+                           linear decay, or gaussian with sigma: > 0)
+      * letterbox:       - map the boxes back to the original image (clamped, empty boxes removed)
+         * :input - by the letterbox of the last set_input_image/yuv/encoded_image
+         * [{scale_x, scale_y, offset_x, offset_y, width, height}, ..] - per image,
+           where model_xy = image_xy*scale + offset
+
+  Returns `{:ok, [%{label => [[score, x1, y1, x2, y2, index]..]}..]}`, one map per image.
+  """
+
+  def non_max_suppression_batch(mod, {num_batch, num_boxes, num_class}, boxes, scores, opts \\ []) do
+    box_repr = case Keyword.get(opts, :boxrepr, :center) do
+      :center  -> 0
+      :topleft -> 1
+      :corner  -> 2
+    end
+
+    iou_threshold   = Keyword.get(opts, :iou_threshold, 0.5)
+    score_threshold = Keyword.get(opts, :score_threshold, 0.25)
+    sigma           = Keyword.get(opts, :sigma, 0.0)
+    flags           = if Keyword.get(opts, :agnostic, false), do: 1, else: 0
+    flags           = flags + case Keyword.get(opts, :method, :auto) do
+      :auto  -> 0
+      :dense -> 2
+      :grid  -> 4
+    end
+    flags           = flags + case Keyword.get(opts, :algorithm, :greedy) do
+      :greedy -> 0
+      :fast   -> 8
+      :matrix -> 16
+    end
+    max_candidates  = Keyword.get(opts, :max_candidates, 0)
+    max_detections  = Keyword.get(opts, :max_detections, 0)
+
+    {flags, mapping} = case Keyword.get(opts, :letterbox) do
+      nil    -> {flags, ""}
+      :input -> {flags + 64, ""}
+      list when is_list(list) ->
+        {flags + 32, (for {sx, sy, ox, oy, w, h} <- list, into: "" do
+          <<sx::little-float-32, sy::little-float-32, ox::little-float-32, oy::little-float-32, w::little-integer-32, h::little-integer-32>>
+        end)}
+    end
+
+    cmd = 10
+    case GenServer.call(mod, <<cmd::little-integer-32, num_batch::little-integer-32, num_boxes::little-integer-32, box_repr::little-integer-32, num_class::little-integer-32,
+                               iou_threshold::little-float-32, score_threshold::little-float-32, sigma::little-float-32,
+                               flags::little-integer-32, max_candidates::little-integer-32, max_detections::little-integer-32>> <> mapping <> boxes <> scores, @timeout) do
+      {:ok, result} ->
+        case Poison.decode(result) do
+          {:ok, %{"status" => 0, "batch" => batch}} -> {:ok, batch}
+          {:ok, %{"status" => status}} -> {:error, status}
+          any -> any
+        end
+      any -> any
+    end
+  end
+
+
+  @doc """
+  Top-k classification on the output tensor inside the interpreter.
+  The last axis of the output tensor is taken as the class scores of each row.
+
+  ## Parameters
+
+    * mod   - modules' names
+    * index - index of output tensor in the model
+    * opts
+      * k:         - number of results per row (default 5)
+      * func:      - :none(default), :softmax or :sigmoid applied to the scores
+      * threshold: - drop the results whose score is less than it (default -inf)
+
+  ## Return
+
+    {:ok, [[[label, index, score], ..], ..]} - a list per row
+  """
+  def topk(mod, index, opts \\ []) do
+    cmd = 8
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> topk_args(index, opts), @timeout) do
+      {:ok, result} -> topk_result(Poison.decode(result))
+      any -> any
+    end
+  end
+
+  defp topk_args(index, opts) do
+    k    = Keyword.get(opts, :k, 5)
+    func = case Keyword.get(opts, :func, :none) do
+      :none    -> 0
+      :softmax -> 1
+      :sigmoid -> 2
+    end
+    threshold = Keyword.get(opts, :threshold, -3.4028234663852886e38)
+
+    <<index::little-integer-32, k::little-integer-32, func::little-integer-32, threshold::little-float-32>>
+  end
+
+  defp topk_result({:ok, %{"status" => 0, "topk" => topk}}), do: {:ok, topk}
+  defp topk_result({:ok, %{"status" => status}}), do: {:error, status}
+  defp topk_result(any), do: any
+
+  @doc """
+  Decode the detection head on the output tensors and execute NMS inside the
+  interpreter. Only the final detections come back over the pipe.
+
+  ## Parameters
+
+    * mod  - modules' names
+    * head - layout of the detection head
+      * {:yolov5, index} - [.., N, 5+C] {cx, cy, w, h, obj, cls..}
+      * {:yolov8, index} - [.., 4+C, N] {cx, cy, w, h, cls..}
+      * {:yolov5_seg, index, proto_index} - YOLOv5-seg, the mask coefficients follow the classes
+      * {:yolov8_seg, index, proto_index} - YOLOv8-seg, the mask coefficients follow the classes
+        and the prototypes are [.., M, H, W]. every detection gets its instance mask
+        %{"rect" => [x, y, w, h], "rle" => [0s, 1s, ..]} (or "bits" => base64 of the bits,
+        msb first) over the pixels of the box, row-major, as the 7th element.
+      * {:yolo_grid, [{index, stride, [{anchor_w, anchor_h}, ..]}, ..]} - raw grid per level
+      * {:ssd, box_index, score_index, anchors} - deltas [.., N, 4], scores [.., N, C] and
+        anchors binary of {cx, cy, w, h} f32 (nil reuses the anchors sent before)
+    * opts
+      * iou_threshold:   - IOU threshold (default 0.5)
+      * score_threshold: - score threshold (default 0.25)
+      * sigma:           - soft-NMS parameter (default 0.0)
+      * sigmoid:         - apply sigmoid to the class scores (default false)
+      * softmax:         - SSD: apply softmax to the class scores (default false)
+      * yx:              - SSD: deltas in {y, x, h, w} order (default false)
+      * variance:        - SSD: {vx, vy, vw, vh} (default {0.1, 0.1, 0.2, 0.2})
+      * background:      - SSD: class column of the background never detected, nil for
+                           none (default 0)
+      * yolov3:          - grid: YOLOv3/v4 box formula (default false)
+      * letterbox:       - map the boxes back to the original image by the letterbox of
+                           the last preprocessed input image (default false)
+      * mask_threshold:  - seg: threshold of the mask probability (default 0.5)
+      * mask_format:     - seg: :rle (default) or :bits
+      * input_size:      - seg: {width, height} of the model input (default 4x the prototypes)
+  """
+  def decode_detection(mod, head, opts \\ []) do
+    cmd = 9
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> detection_args(head, opts), @timeout) do
+      {:ok, result} -> detection_result(Poison.decode(result))
+      any -> any
+    end
+  end
+
+  defp detection_args(head, opts) do
+    iou_threshold   = Keyword.get(opts, :iou_threshold, 0.5)
+    score_threshold = Keyword.get(opts, :score_threshold, 0.25)
+    sigma           = Keyword.get(opts, :sigma, 0.0)
+
+    flags = Enum.reduce([sigmoid: 1, softmax: 2, yx: 4, yolov3: 8, letterbox: 16], 0, fn {key, bit}, acc ->
+      if Keyword.get(opts, key, false), do: Bitwise.bor(acc, bit), else: acc
+    end)
+
+    seg = fn index, proto_index ->
+      mask_threshold = Keyword.get(opts, :mask_threshold, 0.5)
+      {in_width, in_height} = Keyword.get(opts, :input_size, {0, 0})
+      <<index::little-integer-32, proto_index::little-integer-32, mask_threshold::little-float-32,
+        in_width::little-integer-32, in_height::little-integer-32>>
+    end
+    flags = case head do
+      {seg_head, _, _} when seg_head in [:yolov5_seg, :yolov8_seg] ->
+        Bitwise.bor(flags, if(Keyword.get(opts, :mask_format, :rle) == :bits, do: 32 + 64, else: 32))
+      _ ->
+        flags
+    end
+
+    {head, count, data} = case head do
+      {:yolov5, index} ->
+        {0, 0, <<index::little-integer-32>>}
+      {:yolov8, index} ->
+        {1, 0, <<index::little-integer-32>>}
+      {:yolov5_seg, index, proto_index} ->
+        {0, 0, seg.(index, proto_index)}
+      {:yolov8_seg, index, proto_index} ->
+        {1, 0, seg.(index, proto_index)}
+      {:yolo_grid, levels} ->
+        data = for {index, stride, anchors} <- levels, into: "" do
+          <<index::little-integer-32, stride::little-float-32, Enum.count(anchors)::little-integer-32>>
+          <> (for {w, h} <- anchors, into: "", do: <<w::little-float-32, h::little-float-32>>)
+        end
+        {2, Enum.count(levels), data}
+      {:ssd, box_index, score_index, anchors} ->
+        {vx, vy, vw, vh} = Keyword.get(opts, :variance, {0.1, 0.1, 0.2, 0.2})
+        background = case Keyword.get(opts, :background, 0) do
+          nil -> -1
+          class -> class
+        end
+        anchors = anchors || ""
+        {3, 0, <<box_index::little-integer-32, score_index::little-integer-32,
+                 vx::little-float-32, vy::little-float-32, vw::little-float-32, vh::little-float-32,
+                 background::little-signed-integer-32, div(byte_size(anchors), 16)::little-integer-32>> <> anchors}
+    end
+
+    <<head::little-integer-32, flags::little-integer-32,
+      iou_threshold::little-float-32, score_threshold::little-float-32, sigma::little-float-32,
+      count::little-integer-32>> <> data
+  end
+
+  defp detection_result({:ok, nil}), do: :notfind
+  defp detection_result({:ok, %{"status" => status}}) when is_integer(status), do: {:error, status}
+  defp detection_result(any), do: any
+
+  @doc """
+  Per-pixel argmax of the segmentation logits inside the interpreter. Only the
+  label mask comes back over the pipe.
+
+  ## Parameters
+
+    * mod   - modules' names
+    * index - index of output tensor [.., C, H, W] in the model
+    * opts
+      * nhwc:       - the output tensor is [.., H, W, C] (default false)
+      * confidence: - add the softmax probability of the label as u8 0..255 (default false)
+      * size:       - {width, height} of the mask to reply (default: as it is)
+      * letterbox:  - map the mask to the original image by the letterbox of the last
+                      preprocessed input image (default false)
+      * input_size: - {width, height} of the model input covered by the mask, needed
+                      with letterbox: if the mask is smaller than the input
+
+  ## Return
+
+    {:ok, %{width: w, height: h, mask: binary, confidence: binary | nil}} -
+      mask is u8 per pixel, or u16 little endian for more than 256 classes.
+  """
+  def segment(mod, index, opts \\ []) do
+    cmd = 12
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> segment_args(index, opts), @timeout) do
+      {:ok, result} -> segment_result(Poison.decode(result))
+      any -> any
+    end
+  end
+
+  defp segment_args(index, opts) do
+    flags = Enum.reduce([nhwc: 1, confidence: 2, letterbox: 4], 0, fn {key, bit}, acc ->
+      if Keyword.get(opts, key, false), do: Bitwise.bor(acc, bit), else: acc
+    end)
+    {width, height}       = Keyword.get(opts, :size, {0, 0})
+    {in_width, in_height} = Keyword.get(opts, :input_size, {0, 0})
+
+    <<index::little-integer-32, flags::little-integer-32, width::little-integer-32, height::little-integer-32,
+      in_width::little-integer-32, in_height::little-integer-32>>
+  end
+
+  defp segment_result({:ok, %{"status" => 0, "width" => width, "height" => height, "mask" => mask}=result}) do
+    {:ok, %{
+      width:  width,
+      height: height,
+      mask:   Base.decode64!(mask),
+      confidence: if(result["confidence"], do: Base.decode64!(result["confidence"]))
+    }}
+  end
+  defp segment_result({:ok, %{"status" => status}}), do: {:error, status}
+  defp segment_result(any), do: any
+
+  @doc """
+  Find the keypoints on the heatmaps inside the interpreter: 3x3 local maximum,
+  threshold and quadratic sub-pixel refinement on every channel. Only the peaks
+  come back over the pipe.
+
+  ## Parameters
+
+    * mod   - modules' names
+    * index - index of output tensor [.., K, H, W] in the model
+    * opts
+      * nhwc:       - the output tensor is [.., H, W, K] (default false)
+      * sigmoid:    - apply sigmoid to the scores (default false)
+      * threshold:  - score threshold (default 0.1)
+      * max_peaks:  - peaks per keypoint, 1 for a single person, 0 for all (default 1)
+      * letterbox:  - map the keypoints to the original image by the letterbox of the
+                      last preprocessed input image (default false)
+      * input_size: - {width, height} of the model input covered by the heatmaps
+                      (default: the size of the heatmaps)
+
+  ## Return
+
+    {:ok, [{k, x, y, score}, ..]} - in the order of the keypoint and the score
+  """
+  def keypoints(mod, index, opts \\ []) do
+    cmd = 13
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> keypoint_args(index, opts), @timeout) do
+      {:ok, result} -> keypoint_result(Poison.decode(result))
+      any -> any
+    end
+  end
+
+  defp keypoint_args(index, opts) do
+    flags = Enum.reduce([nhwc: 1, sigmoid: 2, letterbox: 4], 0, fn {key, bit}, acc ->
+      if Keyword.get(opts, key, false), do: Bitwise.bor(acc, bit), else: acc
+    end)
+    max_peaks = Keyword.get(opts, :max_peaks, 1)
+    threshold = Keyword.get(opts, :threshold, 0.1)
+    {in_width, in_height} = Keyword.get(opts, :input_size, {0, 0})
+
+    <<index::little-integer-32, flags::little-integer-32, max_peaks::little-integer-32, threshold::little-float-32,
+      in_width::little-integer-32, in_height::little-integer-32>>
+  end
+
+  defp keypoint_result({:ok, %{"status" => 0, "keypoints" => keypoints}}) do
+    {:ok, Enum.map(keypoints, &List.to_tuple/1)}
+  end
+  defp keypoint_result({:ok, %{"status" => status}}), do: {:error, status}
+  defp keypoint_result(any), do: any
+
+  @doc """
+  CTC decoding of the output tensor inside the interpreter, greedy or prefix beam
+  search. Only the decoded sequences come back over the pipe.
+
+  ## Parameters
+
+    * mod   - modules' names
+    * index - index of output tensor [T, C] or [B, T, C] in the model
+    * opts
+      * blank:      - label id of the blank (default 0)
+      * beam_width: - beam width, 1 for the greedy decoding (default 1)
+      * num_result: - number of the best sequences of the beam search (default 1)
+      * threshold:  - labels under this probability are not tried in the beam search
+                      (default 0.0)
+      * input:      - :logits (default), :log_prob or :prob
+      * time_major: - the output tensor is [T, B, C] (default false)
+
+  ## Return
+
+    {:ok, [[{text, score}, ..], ..]} - per sequence. text is the labels joined, or the
+      list of the label ids if no labels are loaded. score is the log probability.
+  """
+  def ctc_decode(mod, index, opts \\ []) do
+    cmd = 14
+    case GenServer.call(mod, <<cmd::little-integer-32>> <> ctc_args(index, opts), @timeout) do
+      {:ok, result} -> ctc_result(Poison.decode(result))
+      any -> any
+    end
+  end
+
+  defp ctc_args(index, opts) do
+    flags = case Keyword.get(opts, :input, :logits) do
+      :log_prob -> 1
+      :prob     -> 2
+      _         -> 0
+    end
+    flags = if Keyword.get(opts, :time_major, false), do: Bitwise.bor(flags, 4), else: flags
+    blank      = Keyword.get(opts, :blank, 0)
+    beam_width = Keyword.get(opts, :beam_width, 1)
+    num_result = Keyword.get(opts, :num_result, 1)
+    threshold  = Keyword.get(opts, :threshold, 0.0)
+
+    <<index::little-integer-32, flags::little-integer-32, blank::little-integer-32, beam_width::little-integer-32,
+      num_result::little-integer-32, threshold::little-float-32>>
+  end
+
+  defp ctc_result({:ok, %{"status" => 0, "decoded" => decoded}}) do
+    {:ok, Enum.map(decoded, fn seq -> Enum.map(seq, &List.to_tuple/1) end)}
+  end
+  defp ctc_result({:ok, %{"status" => status}}), do: {:error, status}
+  defp ctc_result(any), do: any
+
+  @doc """
+  Generate the tokens by the decoder model inside the interpreter. The next token
+  and the present key/values are fed back into the inputs without crossing the pipe.
+
+  ## Parameters
+
+    * mod    - modules' names
+    * prompt - list of the prompt token ids
+    * opts
+      * ids_input:      - index of the input ids [1, S] (default 0)
+      * mask_input:     - index of the attention mask [1, past + S] (default nil)
+      * position_input: - index of the position ids [1, S] (default nil)
+      * logits_output:  - index of the logits [1, S, V] (default 0)
+      * past:           - [{past input index, present output index}, ..] of the key/values.
+                          without them, the whole sequence is fed every step (default [])
+      * past_axis:      - sequence axis of the past key/values (default 2)
+      * max_tokens:     - max number of the tokens to generate (default 32)
+      * stop:           - list of the stop token ids, e.g. EOS (default [])
+      * sampling:       - sample by top_k/top_p/temperature, otherwise greedy (default false)
+      * top_k:          - sample from the k most likely tokens, 0 for all (default 0)
+      * top_p:          - sample from the smallest set over the probability (default 1.0)
+      * temperature:    - temperature of the sampling (default 1.0)
+      * seed:           - seed of the sampling, 0 for random (default 0)
+      * stream:         - pid receiving {:partial, [ids..]} on the way (default nil)
+      * stream_every:   - tokens per partial result (default 1)
+
+    The other inputs keep what is set before (e.g. the encoder states of seq2seq).
+    The backend must support the dynamic shapes of the inputs.
+
+  ## Return
+
+    {:ok, ids, :eos | :length} - generated token ids
+  """
+  def generate(mod, prompt, opts \\ []) do
+    cmd = 15
+    past  = Keyword.get(opts, :past, [])
+    stop  = Keyword.get(opts, :stop, [])
+    flags = if Keyword.get(opts, :sampling, false), do: 1, else: 0
+    stream = Keyword.get(opts, :stream)
+    ids_input      = Keyword.get(opts, :ids_input, 0)
+    mask_input     = Keyword.get(opts, :mask_input) || -1
+    position_input = Keyword.get(opts, :position_input) || -1
+    logits_output  = Keyword.get(opts, :logits_output, 0)
+    max_tokens     = Keyword.get(opts, :max_tokens, 32)
+    top_k          = Keyword.get(opts, :top_k, 0)
+    top_p          = Keyword.get(opts, :top_p, 1.0)
+    temperature    = Keyword.get(opts, :temperature, 1.0)
+    seed           = Keyword.get(opts, :seed, 0)
+    stream_every   = if stream, do: Keyword.get(opts, :stream_every, 1), else: 0
+    past_axis      = Keyword.get(opts, :past_axis, 2)
+
+    cmd_line =
+      <<cmd::little-integer-32, ids_input::little-integer-32, mask_input::little-signed-integer-32,
+        position_input::little-signed-integer-32, logits_output::little-integer-32, flags::little-integer-32,
+        max_tokens::little-integer-32, top_k::little-integer-32, top_p::little-float-32,
+        temperature::little-float-32, seed::little-integer-32, stream_every::little-integer-32,
+        past_axis::little-integer-32, Enum.count(past)::little-integer-32, Enum.count(stop)::little-integer-32,
+        Enum.count(prompt)::little-integer-32>>
+      <> (for {input, output} <- past, into: "", do: <<input::little-integer-32, output::little-integer-32>>)
+      <> (for id <- stop, into: "", do: <<id::little-signed-integer-32>>)
+      <> (for id <- prompt, into: "", do: <<id::little-signed-integer-32>>)
+
+    response = if stream do
+      GenServer.call(mod, {:stream, cmd_line, stream}, @timeout)
+    else
+      GenServer.call(mod, cmd_line, @timeout)
+    end
+
+    case response do
+      {:ok, result} ->
+        case Poison.decode(result) do
+          {:ok, %{"status" => 0, "ids" => ids, "stop" => reason}} -> {:ok, ids, String.to_atom(reason)}
+          {:ok, %{"status" => status}} -> {:error, status}
+          any -> any
+        end
+      any -> any
+    end
+  end
+
+  @doc """
+  Route the recurrent state outputs back to the inputs inside the interpreter.
+  After every invoke, each output tensor is copied into its input tensor as the
+  state of the next step (e.g. the hidden states of RNNs), without crossing the pipe.
+
+  ## Parameters
+
+    * mod    - modules' names
+    * routes - [{output index, input index}, ..]; [] removes the routes
+    * opts
+      * reset: - zero the state inputs now (default false)
+  """
+  def route_state(mod, routes, opts \\ []) do
+    cmd = 16
+    flags = if Keyword.get(opts, :reset, false), do: 1, else: 0
+
+    cmd_line =
+      <<cmd::little-integer-32, flags::little-integer-32, Enum.count(routes)::little-integer-32>>
+      <> (for {output, input} <- routes, into: "", do: <<output::little-integer-32, input::little-integer-32>>)
+
+    case GenServer.call(mod, cmd_line, @timeout) do
+      {:ok, result} ->
+        case Poison.decode(result) do
+          {:ok, %{"status" => 0}} -> :ok
+          {:ok, %{"status" => status}} -> {:error, status}
+          any -> any
+        end
+      any -> any
+    end
+  end
+
+  @doc """
+  Set the input tensors, invoke the model and run the post processors over its
+  output tensors inside the interpreter in one request. The output tensors never
+  cross the pipe.
+
+  ## Parameters
+
+    * session - session with the input tensors (see set_input_tensor/4 etc.)
+    * posts   - list of the post processors
+      * {:topk, index, opts}     - see topk/3
+      * {:detection, head, opts} - see decode_detection/3
+      * {:segment, index, opts}  - see segment/3
+      * {:keypoints, index, opts} - see keypoints/3
+      * {:ctc, index, opts}       - see ctc_decode/3
+
+  ## Return
+
+    {:ok, [result, ..]} - result of each post processor in the order of `posts`
+  """
+  def run_postprocess(%NNInterp{module: mod, inputs: inputs}, posts) do
+    count = Enum.count(inputs)
+    data  = Enum.reverse(inputs) |> Enum.reduce(<<>>, fn x,acc -> acc <> x end)
+
+    posts = Enum.map(posts, fn
+      {:topk, index, opts}     -> {8, topk_args(index, opts), &topk_result/1}
+      {:detection, head, opts} -> {9, detection_args(head, opts), &detection_result/1}
+      {:segment, index, opts}  -> {12, segment_args(index, opts), &segment_result/1}
+      {:keypoints, index, opts} -> {13, keypoint_args(index, opts), &keypoint_result/1}
+      {:ctc, index, opts}       -> {14, ctc_args(index, opts), &ctc_result/1}
+    end)
+    descs = for {cmd, args, _} <- posts, into: "" do
+      <<cmd::little-integer-32, byte_size(args)::little-integer-32>> <> args
+    end
+
+    cmd = 11
+    case GenServer.call(mod, <<cmd::little-integer-32, count::little-integer-32>> <> data <> <<Enum.count(posts)::little-integer-32>> <> descs, @timeout) do
+      {:ok, result} ->
+        case Poison.decode(result) do
+          {:ok, %{"status" => 0, "results" => results}} ->
+            {:ok, Enum.zip(posts, results) |> Enum.map(fn {{_, _, decode}, x} -> decode.({:ok, x}) end)}
+          {:ok, %{"status" => status}} -> {:error, status}
+          any -> any
+        end
+      any -> any
+    end
+  end
 
   @doc """
   Adjust NMS result to aspect of the input image. (letterbox)
+  decode_detection/3 and non_max_suppression_batch/5 can map the boxes inside
+  the interpreter with the letterbox: option instead.
 
   ## Parameters:
 
@@ -0,0 +1,671 @@
+/***  File Header  ************************************************************/
+/**
+* audio.cpp
+*
+* Tiny ML pre processing libraies: audio log-mel spectrogram
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 18:05:44 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <string.h>
+#include <math.h>
+#include <complex>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+
+#include "tiny_ml.h"
+#include "thread_pool.h"
+#include "audio.h"
+
+typedef std::complex<float> Cpx;
+
+/*--- CONSTANT ---*/
+const double PI = 3.14159265358979323846;
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* mixed radix FFT
+* @par DESCRIPTION
+*   forward complex FFT of any size: radix 4/2 butterflies and a generic
+*   one for the other factors (3, 5, ..).
+**/
+/**************************************************************************{{{*/
+class Fft {
+//CONSTRUCTOR
+public:
+    Fft(int n);
+
+//ACTION
+public:
+    void exec(Cpx* out, const Cpx* in) const {
+        work(out, in, 1, mFactor.data());
+    }
+
+protected:
+    void work(Cpx* out, const Cpx* in, size_t fstride, const int* factors) const;
+    void bfly2(Cpx* out, size_t fstride, int m) const;
+    void bfly4(Cpx* out, size_t fstride, int m) const;
+    void bfly_generic(Cpx* out, size_t fstride, int m, int p) const;
+
+//ATTRIBUTE
+protected:
+    int              mN;
+    std::vector<int> mFactor;       // {p0, m0, p1, m1, ..}
+    std::vector<Cpx> mTwiddle;
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* constructor
+* @par DESCRIPTION
+*   factorize the size and make the twiddle table.
+**/
+/**************************************************************************{{{*/
+Fft::Fft(int n) : mN(n), mTwiddle(n)
+{
+    for (int i = 0; i < n; i++) {
+        double phase = -2.0*PI*i/n;
+        mTwiddle[i] = Cpx(static_cast<float>(cos(phase)), static_cast<float>(sin(phase)));
+    }
+
+    int p = 4;
+    double limit = floor(sqrt(static_cast<double>(n)));
+    do {
+        while (n % p) {
+            switch (p) {
+            case 4:  p = 2; break;
+            case 2:  p = 3; break;
+            default: p += 2; break;
+            }
+            if (p > limit) {
+                p = n;
+            }
+        }
+        n /= p;
+        mFactor.push_back(p);
+        mFactor.push_back(n);
+    } while (n > 1);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* FFT stage
+* @par DESCRIPTION
+*   decimation in time: transform the p sub-sequences, then combine them.
+**/
+/**************************************************************************{{{*/
+void
+Fft::work(Cpx* out, const Cpx* in, size_t fstride, const int* factors) const
+{
+    const int p = factors[0];
+    const int m = factors[1];
+    Cpx* const begin = out;
+    Cpx* const end   = out + p*m;
+
+    if (m == 1) {
+        do {
+            *out = *in;
+            in += fstride;
+        } while (++out != end);
+    }
+    else {
+        do {
+            work(out, in, fstride*p, factors + 2);
+            in  += fstride;
+            out += m;
+        } while (out != end);
+    }
+
+    switch (p) {
+    case 2:  bfly2(begin, fstride, m); break;
+    case 4:  bfly4(begin, fstride, m); break;
+    default: bfly_generic(begin, fstride, m, p); break;
+    }
+}
+
+void
+Fft::bfly2(Cpx* out, size_t fstride, int m) const
+{
+    Cpx* out2 = out + m;
+    for (int k = 0; k < m; k++) {
+        Cpx t = out2[k]*mTwiddle[k*fstride];
+        out2[k] = out[k] - t;
+        out[k] += t;
+    }
+}
+
+void
+Fft::bfly4(Cpx* out, size_t fstride, int m) const
+{
+    for (int k = 0; k < m; k++) {
+        Cpx s0 = out[k +   m]*mTwiddle[k*fstride];
+        Cpx s1 = out[k + 2*m]*mTwiddle[2*k*fstride];
+        Cpx s2 = out[k + 3*m]*mTwiddle[3*k*fstride];
+
+        Cpx s5 = out[k] - s1;
+        out[k] += s1;
+        Cpx s3 = s0 + s2;
+        Cpx s4 = s0 - s2;
+
+        out[k + 2*m] = out[k] - s3;
+        out[k]      += s3;
+        out[k +   m] = Cpx(s5.real() + s4.imag(), s5.imag() - s4.real());
+        out[k + 3*m] = Cpx(s5.real() - s4.imag(), s5.imag() + s4.real());
+    }
+}
+
+void
+Fft::bfly_generic(Cpx* out, size_t fstride, int m, int p) const
+{
+    std::vector<Cpx> scratch(p);
+
+    for (int u = 0; u < m; u++) {
+        for (int q = 0, k = u; q < p; q++, k += m) {
+            scratch[q] = out[k];
+        }
+
+        for (int q1 = 0, k = u; q1 < p; q1++, k += m) {
+            size_t twidx = 0;
+            Cpx acc = scratch[0];
+            for (int q = 1; q < p; q++) {
+                twidx += fstride*k;
+                if (twidx >= static_cast<size_t>(mN)) {
+                    twidx -= mN;
+                }
+                acc += scratch[q]*mTwiddle[twidx];
+            }
+            out[k] = acc;
+        }
+    }
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* log-mel front-end
+* @par DESCRIPTION
+*   window, real FFT, power spectrum, mel projection and log of a frame.
+*   the tables are built once per spec and shared by the frames.
+**/
+/**************************************************************************{{{*/
+class MelFrontend {
+//CONSTRUCTOR
+public:
+    MelFrontend(const AudioSpec& spec);
+
+//ACTION
+public:
+    struct Work {
+        std::vector<Cpx>   mIn;
+        std::vector<Cpx>   mOut;
+        std::vector<float> mSpec;
+    };
+    void compute(const float* frame, float* mel, Work& work) const;
+    bool match(const AudioSpec& spec) const;
+
+    float floor_value() const { return log_of(mSpec.eps); }
+
+protected:
+    float log_of(float x) const {
+        x = std::max(x, mSpec.eps);
+        switch (mSpec.log) {
+        case 1:  return log10f(x);
+        case 2:  return 10.0f*log10f(x);
+        default: return logf(x);
+        }
+    }
+
+//ATTRIBUTE
+public:
+    AudioSpec          mSpec;
+    int                mN;          // n_fft
+    int                mBins;       // n_fft/2 + 1
+    bool               mReal;       // real FFT by the half size complex FFT
+    Fft                mFft;
+    std::vector<Cpx>   mSuper;      // twiddles of the real FFT post-processing
+    std::vector<float> mWindow;     // n_fft, zero padded window
+    std::vector<int>   mMelStart;   // first bin of each filter
+    std::vector<std::vector<float>> mMelWeight;
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* mel scale
+**/
+/**************************************************************************{{{*/
+static double
+hz_to_mel(double hz, bool slaney)
+{
+    if (!slaney) {
+        return 2595.0*log10(1.0 + hz/700.0);
+    }
+    const double f_sp = 200.0/3.0, logstep = log(6.4)/27.0;
+    return (hz < 1000.0) ? hz/f_sp : 15.0 + log(hz/1000.0)/logstep;
+}
+
+static double
+mel_to_hz(double mel, bool slaney)
+{
+    if (!slaney) {
+        return 700.0*(pow(10.0, mel/2595.0) - 1.0);
+    }
+    const double f_sp = 200.0/3.0, logstep = log(6.4)/27.0;
+    return (mel < 15.0) ? mel*f_sp : 1000.0*exp(logstep*(mel - 15.0));
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* constructor
+* @par DESCRIPTION
+*   build the window and the mel filterbank.
+**/
+/**************************************************************************{{{*/
+MelFrontend::MelFrontend(const AudioSpec& spec) :
+    mSpec(spec), mN(spec.n_fft), mBins(spec.n_fft/2 + 1), mReal(spec.n_fft % 2 == 0),
+    mFft(mReal ? spec.n_fft/2 : spec.n_fft), mWindow(spec.n_fft, 0.0f)
+{
+    // periodic window centered in n_fft
+    int win    = (spec.win_length > 0) ? spec.win_length : spec.n_fft;
+    int offset = (mN - win)/2;
+    for (int i = 0; i < win; i++) {
+        double c = cos(2.0*PI*i/win);
+        mWindow[offset + i] = static_cast<float>((spec.window == 1) ? 0.54 - 0.46*c : 0.5 - 0.5*c);
+    }
+
+    if (mReal) {
+        mSuper.resize(mN/2 + 1);
+        for (int k = 0; k <= mN/2; k++) {
+            double phase = -2.0*PI*k/mN;
+            mSuper[k] = Cpx(static_cast<float>(cos(phase)), static_cast<float>(sin(phase)));
+        }
+    }
+
+    // triangular filters on the mel scale
+    bool   slaney = (spec.mel == 1);
+    double fmax   = (spec.fmax > 0.0f) ? spec.fmax : spec.sample_rate/2.0;
+    double mlo    = hz_to_mel(spec.fmin, slaney);
+    double mhi    = hz_to_mel(fmax, slaney);
+
+    std::vector<double> fpt(spec.n_mels + 2);
+    for (size_t i = 0; i < fpt.size(); i++) {
+        fpt[i] = mel_to_hz(mlo + (mhi - mlo)*i/(spec.n_mels + 1), slaney);
+    }
+
+    mMelStart.resize(spec.n_mels);
+    mMelWeight.resize(spec.n_mels);
+    for (unsigned int m = 0; m < spec.n_mels; m++) {
+        double enorm = slaney ? 2.0/(fpt[m+2] - fpt[m]) : 1.0;
+        int first = -1;
+        std::vector<float> weight;
+        for (int k = 0; k < mBins; k++) {
+            double f     = static_cast<double>(k)*spec.sample_rate/mN;
+            double lower = (f - fpt[m])/(fpt[m+1] - fpt[m]);
+            double upper = (fpt[m+2] - f)/(fpt[m+2] - fpt[m+1]);
+            double w     = std::max(0.0, std::min(lower, upper));
+            if (w > 0.0) {
+                if (first < 0) {
+                    first = k;
+                }
+                weight.resize(k - first + 1, 0.0f);
+                weight[k - first] = static_cast<float>(w*enorm);
+            }
+        }
+        mMelStart[m]  = std::max(first, 0);
+        mMelWeight[m] = weight;
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* is the front-end built for the spec?
+**/
+/**************************************************************************{{{*/
+bool
+MelFrontend::match(const AudioSpec& spec) const
+{
+    return spec.sample_rate == mSpec.sample_rate
+        && spec.n_fft       == mSpec.n_fft
+        && spec.win_length  == mSpec.win_length
+        && spec.n_mels      == mSpec.n_mels
+        && spec.fmin        == mSpec.fmin
+        && spec.fmax        == mSpec.fmax
+        && spec.window      == mSpec.window
+        && spec.mel         == mSpec.mel
+        && spec.power       == mSpec.power
+        && spec.log         == mSpec.log
+        && spec.eps         == mSpec.eps;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* log-mel of a frame
+* @par DESCRIPTION
+*   "frame" has n_fft samples, "mel" receives n_mels values.
+**/
+/**************************************************************************{{{*/
+void
+MelFrontend::compute(const float* frame, float* mel, Work& work) const
+{
+    work.mSpec.resize(mBins);
+    float* spec = work.mSpec.data();
+
+    if (mReal) {
+        // pack the even/odd samples into a half size complex sequence
+        const int half = mN/2;
+        work.mIn.resize(half);
+        work.mOut.resize(half);
+        for (int i = 0; i < half; i++) {
+            work.mIn[i] = Cpx(frame[2*i]*mWindow[2*i], frame[2*i+1]*mWindow[2*i+1]);
+        }
+        mFft.exec(work.mOut.data(), work.mIn.data());
+
+        const Cpx* Z = work.mOut.data();
+        for (int k = 0; k <= half; k++) {
+            Cpx zk = Z[k % half];
+            Cpx zn = std::conj(Z[(half - k) % half]);
+            Cpx fe = (zk + zn)*0.5f;
+            Cpx fo = (zk - zn)*Cpx(0.0f, -0.5f);
+            Cpx x  = fe + mSuper[k]*fo;
+            spec[k] = x.real()*x.real() + x.imag()*x.imag();
+        }
+    }
+    else {
+        work.mIn.resize(mN);
+        work.mOut.resize(mN);
+        for (int i = 0; i < mN; i++) {
+            work.mIn[i] = Cpx(frame[i]*mWindow[i], 0.0f);
+        }
+        mFft.exec(work.mOut.data(), work.mIn.data());
+
+        for (int k = 0; k < mBins; k++) {
+            const Cpx& x = work.mOut[k];
+            spec[k] = x.real()*x.real() + x.imag()*x.imag();
+        }
+    }
+
+    if (mSpec.power == 1) {
+        for (int k = 0; k < mBins; k++) {
+            spec[k] = sqrtf(spec[k]);
+        }
+    }
+
+    for (size_t m = 0; m < mMelWeight.size(); m++) {
+        const float* w = mMelWeight[m].data();
+        const float* s = spec + mMelStart[m];
+        const size_t n = mMelWeight[m].size();
+        float acc = 0.0f;
+        for (size_t i = 0; i < n; i++) {
+            acc += w[i]*s[i];
+        }
+        mel[m] = log_of(acc);
+    }
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* streaming state of an input tensor
+**/
+/**************************************************************************{{{*/
+struct AudioStream {
+    std::shared_ptr<MelFrontend>   mFrontend;
+    unsigned int                   mHop;
+    std::vector<float>             mSamples;    // samples not yet framed
+    size_t                         mHead;       // start of the next frame in mSamples
+    size_t                         mSkip;       // samples to drop when hop > n_fft
+    std::deque<std::vector<float>> mFrames;     // newest log-mel frames
+};
+
+static std::map<unsigned int, AudioStream> gStream;
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* get the front-end for the spec
+* @par DESCRIPTION
+*   the tables are rebuilt only when the spec changes.
+**/
+/**************************************************************************{{{*/
+static std::shared_ptr<MelFrontend>
+frontend(const AudioSpec& spec)
+{
+    static std::shared_ptr<MelFrontend> cache;
+
+    if (!cache || !cache->match(spec)) {
+        cache = std::make_shared<MelFrontend>(spec);
+    }
+    return cache;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* PCM to mono float
+**/
+/**************************************************************************{{{*/
+static void
+to_mono(const uint8_t* data, size_t size, const AudioSpec& spec, std::vector<float>& mono)
+{
+    const size_t width    = (spec.format == 0) ? sizeof(int16_t) : sizeof(float);
+    const size_t channels = std::max(spec.channels, 1u);
+    const size_t count    = size/(width*channels);
+
+    mono.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        float acc = 0.0f;
+        for (size_t c = 0; c < channels; c++, data += width) {
+            if (spec.format == 0) {
+                int16_t s;
+                memcpy(&s, data, sizeof(s));
+                acc += s/32768.0f;
+            }
+            else {
+                float s;
+                memcpy(&s, data, sizeof(s));
+                acc += s;
+            }
+        }
+        mono[i] = acc/channels;
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* write a log-mel frame to the tensor
+**/
+/**************************************************************************{{{*/
+static inline void
+put_frame(float* tensor, size_t t, const float* mel, const AudioSpec& spec, size_t frames)
+{
+    if (spec.layout == 0) {
+        for (size_t m = 0; m < spec.n_mels; m++) {
+            tensor[m*frames + t] = mel[m];
+        }
+    }
+    else {
+        memcpy(tensor + t*spec.n_mels, mel, spec.n_mels*sizeof(float));
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* one-shot spectrogram
+* @par DESCRIPTION
+*   frames are computed in parallel from the beginning of the signal.
+*   the tensor frames beyond the signal are filled with the log floor.
+**/
+/**************************************************************************{{{*/
+static void
+spectrogram(float* tensor, size_t frames, const std::vector<float>& mono, const AudioSpec& spec, const MelFrontend& fe)
+{
+    const size_t n_fft = spec.n_fft;
+
+    // reflect padding
+    std::vector<float> signal;
+    const std::vector<float>* src = &mono;
+    if (spec.center) {
+        const long pad = n_fft/2;
+        const long len = mono.size();
+        signal.resize(len + 2*pad, 0.0f);
+        for (long i = 0; i < len + 2*pad; i++) {
+            long j = i - pad;
+            if (j < 0) j = -j;
+            if (j >= len) j = 2*len - 2 - j;
+            if (j >= 0 && j < len) {
+                signal[i] = mono[j];
+            }
+        }
+        src = &signal;
+    }
+
+    const size_t length = src->size();
+    size_t count = (length <= n_fft) ? 1 : 1 + (length - n_fft)/spec.hop;
+    count = std::min(count, frames);
+
+    thread_pool().parallel_for(count, [&](size_t begin, size_t end) {
+        MelFrontend::Work work;
+        std::vector<float> frame(n_fft);
+        std::vector<float> mel(spec.n_mels);
+        for (size_t t = begin; t < end; t++) {
+            size_t start = t*spec.hop;
+            size_t n     = std::min(n_fft, length - std::min(start, length));
+            std::fill(std::copy(src->begin() + start, src->begin() + start + n, frame.begin()), frame.end(), 0.0f);
+
+            fe.compute(frame.data(), mel.data(), work);
+            put_frame(tensor, t, mel.data(), spec, frames);
+        }
+    }, 4);
+
+    std::vector<float> floor(spec.n_mels, fe.floor_value());
+    for (size_t t = count; t < frames; t++) {
+        put_frame(tensor, t, floor.data(), spec, frames);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* streaming spectrogram
+* @par DESCRIPTION
+*   append the samples to the ring and compute the new frames only. the
+*   tensor holds the newest frames, older ones first.
+**/
+/**************************************************************************{{{*/
+static void
+stream_spectrogram(float* tensor, size_t frames, const std::vector<float>& mono, const AudioSpec& spec, AudioStream& st)
+{
+    const size_t n_fft = spec.n_fft;
+    const MelFrontend& fe = *st.mFrontend;
+
+    size_t skip = std::min(st.mSkip, mono.size());
+    st.mSkip -= skip;
+    st.mSamples.insert(st.mSamples.end(), mono.begin() + skip, mono.end());
+
+    MelFrontend::Work work;
+    while (st.mSamples.size() - st.mHead >= n_fft) {
+        std::vector<float> mel(spec.n_mels);
+        fe.compute(st.mSamples.data() + st.mHead, mel.data(), work);
+
+        st.mFrames.push_back(std::move(mel));
+        if (st.mFrames.size() > frames) {
+            st.mFrames.pop_front();
+        }
+
+        size_t advance = std::min<size_t>(spec.hop, st.mSamples.size() - st.mHead);
+        st.mHead += advance;
+        st.mSkip  = spec.hop - advance;
+    }
+
+    // compact the ring
+    if (st.mHead > 0) {
+        st.mSamples.erase(st.mSamples.begin(), st.mSamples.begin() + st.mHead);
+        st.mHead = 0;
+    }
+
+    size_t lead = frames - st.mFrames.size();
+    std::vector<float> floor(spec.n_mels, fe.floor_value());
+    for (size_t t = 0; t < lead; t++) {
+        put_frame(tensor, t, floor.data(), spec, frames);
+    }
+    for (size_t t = 0; t < st.mFrames.size(); t++) {
+        put_frame(tensor, lead + t, st.mFrames[t].data(), spec, frames);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set PCM audio to input tensor
+* @par DESCRIPTION
+*   input dtype 7: PCM (s16/f32) with the spectrogram spec. the log-mel
+*   spectrogram is written into the f32 input tensor shaped
+*   [.., n_mels, frames] or [.., frames, n_mels].
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+int
+set_input_audio(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        unsigned int index;
+        unsigned int dtype;
+        AudioSpec    spec;
+        uint8_t      data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    if (data_size < 0) {
+        return -2;
+    }
+
+    AudioSpec spec;
+    memcpy(&spec, &prms->spec, sizeof(spec));
+    if (spec.format > 1 || spec.sample_rate == 0 || spec.n_fft < 2 || spec.n_fft > 65536
+    ||  spec.hop == 0 || spec.win_length > spec.n_fft || spec.n_mels == 0
+    ||  spec.fmin < 0.0f || spec.fmax > spec.sample_rate/2.0f || spec.eps <= 0.0f) {
+        return -3;
+    }
+
+    TensorView view;
+    if (!interp->get_input_buffer(prms->index, view)) {
+        return -1;
+    }
+    size_t rank = view.mShape.size();
+    if (view.mDType != TensorSpec::DTYPE_F32 || rank < 2) {
+        return -3;
+    }
+    size_t mels   = static_cast<size_t>(view.mShape[(spec.layout == 0) ? rank-2 : rank-1]);
+    size_t frames = static_cast<size_t>(view.mShape[(spec.layout == 0) ? rank-1 : rank-2]);
+    if (mels != spec.n_mels || view.count() != mels*frames) {
+        return -3;
+    }
+
+    std::vector<float> mono;
+    to_mono(prms->data, data_size, spec, mono);
+
+    float* tensor = reinterpret_cast<float*>(view.mData);
+    if (spec.stream == 0) {
+        gStream.erase(prms->index);
+        spectrogram(tensor, frames, mono, spec, *frontend(spec));
+    }
+    else {
+        AudioStream& st = gStream[prms->index];
+        if (spec.stream == 2 || !st.mFrontend || !st.mFrontend->match(spec) || st.mHop != spec.hop) {
+            st.mFrontend = frontend(spec);
+            st.mHop      = spec.hop;
+            st.mSamples.clear();
+            st.mHead = 0;
+            st.mSkip = 0;
+            st.mFrames.clear();
+        }
+        stream_spectrogram(tensor, frames, mono, spec, st);
+    }
+
+    return prms_size;
+}
+
+/*** audio.cpp ************************************************************}}}*/
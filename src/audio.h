@@ -0,0 +1,43 @@
+/***  File Header  ************************************************************/
+/**
+* audio.h
+*
+* Tiny ML pre processing libraies: audio log-mel spectrogram
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 18:05:44 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _AUDIO_H
+#define _AUDIO_H
+
+/**************************************************************************}}}**
+* parameters of the log-mel spectrogram
+***************************************************************************{{{*/
+PACK(
+struct AudioSpec {
+    unsigned int format;        // 0:s16, 1:f32
+    unsigned int channels;      // interleaved channels are averaged to mono
+    unsigned int sample_rate;
+    unsigned int n_fft;
+    unsigned int hop;
+    unsigned int win_length;    // 0: n_fft
+    unsigned int n_mels;
+    float        fmin;
+    float        fmax;          // 0: sample_rate/2
+    unsigned int window;        // 0:hann, 1:hamming
+    unsigned int mel;           // 0:HTK, 1:Slaney (area normalized)
+    unsigned int power;         // 1:magnitude, 2:power
+    unsigned int log;           // 0:ln, 1:log10, 2:dB
+    float        eps;           // floor of the spectrum before the log
+    unsigned int layout;        // 0:[mels, frames], 1:[frames, mels]
+    unsigned int center;        // reflect padding of n_fft/2 (one-shot only)
+    unsigned int stream;        // 0:one-shot, 1:append to the ring, 2:reset and append
+});
+
+/**************************************************************************}}}**
+*
+***************************************************************************{{{*/
+int set_input_audio(TinyMLInterp* interp, const void* args);
+
+#endif /* _AUDIO_H */
@@ -0,0 +1,386 @@
+/***  File Header  ************************************************************/
+/**
+* ctc.cpp
+*
+* Tiny ML post processing libraies: CTC decoder
+* @author      Shozo Fukuda
+* @date create Wed Oct 21 16:40:12 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "thread_pool.h"
+#include "postprocess.h"
+
+/*--- CONSTANT ---*/
+const uint32_t EMPTY = 0xFFFFFFFFu;     // free slot of FlatMap
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* open addressing hash map of 64bit keys
+* @par DESCRIPTION
+*   linear probing over a power of 2 table. the values live in one flat
+*   array, so clear() keeps the memory for the next frame.
+**/
+/**************************************************************************{{{*/
+template <class V>
+class FlatMap {
+//LIFECYCLE:
+public:
+    FlatMap() { clear(16); }
+
+//ACTION:
+public:
+    void clear(size_t capacity) {
+        size_t n = 16;
+        while (n < 2*capacity) { n <<= 1; }
+        mSlot.assign(n, EMPTY);
+        mKey.clear();
+        mVal.clear();
+    }
+
+    // value of the key, inserting "init" if it is new
+    V& get(uint64_t key, const V& init) {
+        if (2*(mKey.size() + 1) > mSlot.size()) {
+            rehash(2*mSlot.size());
+        }
+        size_t i = probe(key);
+        if (mSlot[i] == EMPTY) {
+            mSlot[i] = static_cast<uint32_t>(mKey.size());
+            mKey.push_back(key);
+            mVal.push_back(init);
+        }
+        return mVal[mSlot[i]];
+    }
+
+//INQUIRY:
+public:
+    size_t   size() const           { return mKey.size(); }
+    uint64_t key(size_t i) const    { return mKey[i]; }
+    const V& value(size_t i) const  { return mVal[i]; }
+
+//HELPER:
+private:
+    size_t probe(uint64_t key) const {
+        size_t mask = mSlot.size() - 1;
+        size_t i = static_cast<size_t>((key*0x9E3779B97F4A7C15ull) >> 32) & mask;
+        while (mSlot[i] != EMPTY && mKey[mSlot[i]] != key) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void rehash(size_t n) {
+        mSlot.assign(n, EMPTY);
+        for (size_t k = 0; k < mKey.size(); k++) {
+            mSlot[probe(mKey[k])] = static_cast<uint32_t>(k);
+        }
+    }
+
+//ATTRIBUTE:
+private:
+    std::vector<uint32_t> mSlot;    // index of mKey/mVal or EMPTY
+    std::vector<uint64_t> mKey;
+    std::vector<V>        mVal;
+};
+
+typedef std::pair<std::vector<int>, float> Decoded;     // {label ids, log probability}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* log(exp(a) + exp(b))
+**/
+/**************************************************************************{{{*/
+static inline float
+log_add(float a, float b)
+{
+    if (a < b) {
+        std::swap(a, b);
+    }
+    return (b == -INFINITY) ? a : a + log1pf(expf(b - a));
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* normalize a frame into the log probability
+* @par DESCRIPTION
+*   form: 0:logits (log softmax), 1:log probability, 2:probability
+*
+**/
+/**************************************************************************{{{*/
+static void
+log_prob(float* x, size_t count, unsigned int form)
+{
+    if (form == 1) {
+        return;
+    }
+    if (form == 2) {
+        for (size_t c = 0; c < count; c++) {
+            x[c] = logf(x[c]);
+        }
+        return;
+    }
+
+    float m = max_f32(x, count);
+    float sum = 0.0f;
+    for (size_t c = 0; c < count; c++) {
+        sum += expf(x[c] - m);
+    }
+    float norm = m + logf(sum);
+    for (size_t c = 0; c < count; c++) {
+        x[c] -= norm;
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* CTC greedy decoding
+* @par DESCRIPTION
+*   best label of every frame, then the repeats are collapsed and the
+*   blanks are removed. the score is the log probability of the best path.
+*
+**/
+/**************************************************************************{{{*/
+static Decoded
+ctc_greedy(const float* x, size_t frames, size_t classes, size_t step, int blank)
+{
+    Decoded res;
+    res.second = 0.0f;
+
+    int prev = -1;
+    for (size_t t = 0; t < frames; t++, x += step) {
+        float best = max_f32(x, classes);
+        int   id   = static_cast<int>(std::find(x, x + classes, best) - x);
+        res.second += best;
+        if (id != blank && id != prev) {
+            res.first.push_back(id);
+        }
+        prev = id;
+    }
+    return res;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* CTC prefix beam search
+* @par DESCRIPTION
+*   a prefix is a node of the trie, and is keyed by (parent node, label).
+*   every frame, the beams are extended into a flat hash map of the keys
+*   keeping the probabilities ending in blank/non-blank, and the best
+*   beam_width ones survive. only the survivors become the trie nodes.
+*   labels whose log probability is under "prune" are not tried.
+*
+* @retval the best num_result prefixes
+**/
+/**************************************************************************{{{*/
+static void
+ctc_beam_search(const float* x, size_t frames, size_t classes, size_t step, int blank,
+                size_t beam_width, float prune, size_t num_result, std::vector<Decoded>& result)
+{
+    struct Node { uint32_t mParent; int mLabel; };
+    struct Prob { float mBlank, mNonBlank; };
+    struct Beam {
+        uint64_t mKey;
+        uint32_t mNode;
+        Prob     mProb;
+        float total() const { return log_add(mProb.mBlank, mProb.mNonBlank); }
+    };
+    const Prob ZERO = { -INFINITY, -INFINITY };
+
+    auto key_of = [](uint32_t parent, int label) {
+        return (static_cast<uint64_t>(parent) << 32) | static_cast<uint32_t>(label);
+    };
+    auto higher = [](const Beam& a, const Beam& b) {
+        float ta = a.total(), tb = b.total();
+        return (ta > tb) || (ta == tb && a.mKey < b.mKey);
+    };
+
+    std::vector<Node>  trie(1, Node{ 0, -1 });     // root: empty prefix
+    FlatMap<uint32_t>  child;                       // key -> node
+    FlatMap<Prob>      next;                        // key -> probabilities
+    std::vector<Beam>  beams(1, Beam{ key_of(0, -1), 0, { 0.0f, -INFINITY } });
+    std::vector<int>   labels;
+
+    for (size_t t = 0; t < frames; t++, x += step) {
+        labels.clear();
+        for (size_t c = 0; c < classes; c++) {
+            if (static_cast<int>(c) != blank && x[c] >= prune) {
+                labels.push_back(static_cast<int>(c));
+            }
+        }
+
+        next.clear(beams.size()*(labels.size() + 1));
+        for (const auto& beam : beams) {
+            const float total = beam.total();
+            const int   last  = trie[beam.mNode].mLabel;
+
+            Prob& stay = next.get(beam.mKey, ZERO);
+            stay.mBlank = log_add(stay.mBlank, total + x[blank]);
+            if (last >= 0) {
+                stay.mNonBlank = log_add(stay.mNonBlank, beam.mProb.mNonBlank + x[last]);
+            }
+
+            for (int c : labels) {
+                Prob& p = next.get(key_of(beam.mNode, c), ZERO);
+                // a repeat is a new label only after a blank
+                p.mNonBlank = log_add(p.mNonBlank, ((c == last) ? beam.mProb.mBlank : total) + x[c]);
+            }
+        }
+
+        beams.clear();
+        for (size_t i = 0; i < next.size(); i++) {
+            beams.push_back(Beam{ next.key(i), 0, next.value(i) });
+        }
+        if (beams.size() > beam_width) {
+            std::nth_element(beams.begin(), beams.begin() + beam_width, beams.end(), higher);
+            beams.resize(beam_width);
+        }
+        std::sort(beams.begin(), beams.end(), higher);
+
+        for (auto& beam : beams) {
+            if (beam.mKey == key_of(0, -1)) {
+                continue;
+            }
+            uint32_t& node = child.get(beam.mKey, static_cast<uint32_t>(trie.size()));
+            if (node == trie.size()) {
+                trie.push_back(Node{ static_cast<uint32_t>(beam.mKey >> 32), static_cast<int>(beam.mKey & 0xFFFFFFFFu) });
+            }
+            beam.mNode = node;
+        }
+    }
+
+    result.clear();
+    for (size_t i = 0; i < beams.size() && i < num_result; i++) {
+        Decoded dec;
+        for (uint32_t node = beams[i].mNode; node != 0; node = trie[node].mParent) {
+            dec.first.push_back(trie[node].mLabel);
+        }
+        std::reverse(dec.first.begin(), dec.first.end());
+        dec.second = beams[i].total();
+        result.push_back(std::move(dec));
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* CTC decoding of the output tensor
+* @par DESCRIPTION
+*   decode the frames of the output tensor [T, C], [B, T, C] (or [T, B, C]
+*   with flags 4). the sequences of a batch are decoded in parallel.
+*   beam_width <= 1 is the greedy decoding.
+*   flags:
+*     1: the tensor is the log probability
+*     2: the tensor is the probability (otherwise the logits)
+*     4: time major [T, B, C]
+*   threshold: labels under this probability are not tried in the beam
+*   search (0: all)
+*   num_result: number of the best sequences to reply (0: 1)
+*
+* @retval json {"status":0, "decoded":[[[text, score]..]..]} per sequence.
+*              text is the labels joined, or the list of the label ids if
+*              no labels are loaded. score is the log probability.
+**/
+/**************************************************************************{{{*/
+std::string
+ctc_decode(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int index;
+        unsigned int flags;
+        unsigned int blank;
+        unsigned int beam_width;
+        unsigned int num_result;
+        float        threshold;
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    auto error = [](int status) {
+        json res;
+        res["status"] = status;
+        return res.dump();
+    };
+
+    TensorView view;
+    if (prms->index >= sys.mInterp->OutputCount() || !sys.mInterp->get_output_buffer(prms->index, view)) {
+        return error(-1);
+    }
+    if ((view.mDType != TensorSpec::DTYPE_F32 && view.mDType != TensorSpec::DTYPE_F16)
+    ||  view.mShape.size() < 2) {
+        return error(-3);
+    }
+
+    const size_t rank    = view.mShape.size();
+    const bool   tmajor  = (prms->flags & 4) != 0;
+    const size_t classes = static_cast<size_t>(view.mShape[rank-1]);
+    const size_t frames  = static_cast<size_t>((rank > 2 && tmajor) ? view.mShape[rank-3] : view.mShape[rank-2]);
+    const size_t batch   = (rank > 2) ? static_cast<size_t>(tmajor ? view.mShape[rank-2] : view.mShape[rank-3]) : 1;
+    if (classes == 0 || prms->blank >= classes) {
+        return error(-3);
+    }
+
+    const unsigned int form = (prms->flags & 1) ? 1 : (prms->flags & 2) ? 2 : 0;
+    const bool         is_f16 = (view.mDType == TensorSpec::DTYPE_F16);
+    const int          blank  = static_cast<int>(prms->blank);
+    const float        prune  = (prms->threshold > 0.0f) ? logf(prms->threshold) : -INFINITY;
+    const size_t       num_result = std::max(prms->num_result, 1u);
+
+    std::vector<std::vector<Decoded>> result(batch);
+    thread_pool().parallel_for(batch, [&](size_t begin, size_t end) {
+        std::vector<float> lp(frames*classes);
+        for (size_t b = begin; b < end; b++) {
+            // frames of the sequence b in the log probability
+            for (size_t t = 0; t < frames; t++) {
+                size_t row = tmajor ? t*batch + b : b*frames + t;
+                float* dst = &lp[t*classes];
+                if (is_f16) {
+                    f16_to_f32(dst, reinterpret_cast<const uint8_t*>(view.mData) + 2*row*classes, classes);
+                }
+                else {
+                    memcpy(dst, reinterpret_cast<const float*>(view.mData) + row*classes, classes*sizeof(float));
+                }
+                log_prob(dst, classes, form);
+            }
+
+            if (prms->beam_width <= 1) {
+                result[b].push_back(ctc_greedy(lp.data(), frames, classes, classes, blank));
+            }
+            else {
+                ctc_beam_search(lp.data(), frames, classes, classes, blank, prms->beam_width, prune, num_result, result[b]);
+            }
+        }
+    }, 1);
+
+    json res;
+    res["status"]  = 0;
+    res["decoded"] = json::array();
+    for (const auto& seq : result) {
+        json items = json::array();
+        for (const auto& dec : seq) {
+            if (sys.mLabel.empty()) {
+                items.push_back({ dec.first, dec.second });
+            }
+            else {
+                std::string text;
+                for (int id : dec.first) {
+                    text += sys.label(id);
+                }
+                items.push_back({ text, dec.second });
+            }
+        }
+        res["decoded"].push_back(items);
+    }
+
+    sys.LAP_OUTPUT();
+
+    return res.dump();
+}
+
+/*** ctc.cpp **************************************************************}}}*/
@@ -0,0 +1,233 @@
+/***  File Header  ************************************************************/
+/**
+* decode_image.cpp
+*
+* Tiny ML pre processing libraies: JPEG/PNG decoder
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 16:40:12 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <limits.h>
+
+#include "tiny_ml.h"
+#include "preprocess.h"
+
+#ifdef USE_JPEG
+#include <jpeglib.h>
+#endif
+#ifdef USE_PNG
+#include <png.h>
+#endif
+#ifdef USE_STB
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#include "stb_image.h"
+#endif
+
+#ifdef USE_JPEG
+/***  Type ****************************************************************}}}*/
+/**
+* error handler of libjpeg: escape by longjmp instead of exit()
+**/
+/**************************************************************************{{{*/
+struct JpegError {
+    struct jpeg_error_mgr mPub;
+    jmp_buf               mEscape;
+};
+
+static void
+jpeg_error_exit(j_common_ptr cinfo)
+{
+    JpegError* err = reinterpret_cast<JpegError*>(cinfo->err);
+    longjmp(err->mEscape, 1);
+}
+
+static void
+jpeg_output_message(j_common_ptr)
+{
+    // keep quiet: a corrupt-data warning is not worth a line on stderr.
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode JPEG
+* @par DESCRIPTION
+*   decode with the scaled IDCT (1/1, 1/2, 1/4, 1/8) not to exceed the
+*   reduction ratio acceptable for the original size.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+decode_jpeg(const uint8_t* data, size_t size, std::function<float(int, int)> reduce, DecodedImage& image)
+{
+    struct jpeg_decompress_struct cinfo;
+    JpegError err;
+
+    cinfo.err = jpeg_std_error(&err.mPub);
+    err.mPub.error_exit     = jpeg_error_exit;
+    err.mPub.output_message = jpeg_output_message;
+    if (setjmp(err.mEscape)) {
+        jpeg_destroy_decompress(&cinfo);
+        return -5;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), size);
+    jpeg_read_header(&cinfo, TRUE);
+
+    image.mOrgWidth  = cinfo.image_width;
+    image.mOrgHeight = cinfo.image_height;
+
+    float ratio = reduce(image.mOrgWidth, image.mOrgHeight);
+    unsigned int denom = 1;
+    while (denom < 8 && 2*denom <= ratio) {
+        denom *= 2;
+    }
+    cinfo.scale_num       = 1;
+    cinfo.scale_denom     = denom;
+    cinfo.out_color_space = JCS_RGB;
+
+    jpeg_start_decompress(&cinfo);
+
+    image.mWidth    = cinfo.output_width;
+    image.mHeight   = cinfo.output_height;
+    image.mChannels = 3;
+    image.mPixel.resize(static_cast<size_t>(image.mWidth)*image.mHeight*3);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = &image.mPixel[static_cast<size_t>(cinfo.output_scanline)*image.mWidth*3];
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    return 0;
+}
+#endif
+
+#ifdef USE_PNG
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode PNG
+* @par DESCRIPTION
+*   decode to 8bit RGB by the simplified API of libpng.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+decode_png(const uint8_t* data, size_t size, DecodedImage& image)
+{
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+
+    if (!png_image_begin_read_from_memory(&png, data, size)) {
+        return -5;
+    }
+
+    png.format = PNG_FORMAT_RGB;
+
+    image.mOrgWidth  = image.mWidth  = png.width;
+    image.mOrgHeight = image.mHeight = png.height;
+    image.mChannels  = 3;
+    image.mPixel.resize(PNG_IMAGE_SIZE(png));
+
+    if (!png_image_finish_read(&png, nullptr, image.mPixel.data(), 0, nullptr)) {
+        png_image_free(&png);
+        return -5;
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef USE_STB
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode JPEG/PNG by the vendored stb_image
+* @par DESCRIPTION
+*   the fallback without libjpeg/libpng of the system. no reduction in
+*   decoding: the image is decoded in the original size.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+decode_stb(const uint8_t* data, size_t size, DecodedImage& image)
+{
+    if (size > static_cast<size_t>(INT_MAX)) {
+        return -5;
+    }
+
+    int width, height, channels;
+    stbi_uc* pixel = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 3);
+    if (pixel == nullptr) {
+        return -5;
+    }
+
+    image.mOrgWidth  = image.mWidth  = width;
+    image.mOrgHeight = image.mHeight = height;
+    image.mChannels  = 3;
+    image.mPixel.assign(pixel, pixel + static_cast<size_t>(width)*height*3);
+
+    stbi_image_free(pixel);
+    return 0;
+}
+#endif
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode the encoded image
+* @par DESCRIPTION
+*   detect the format by the signature and decode it to u8 RGB.
+*   "reduce" returns the acceptable reduction ratio (>= 1.0) for the
+*   original width/height.
+*   libjpeg/libpng of the system are used if found, otherwise stb_image.
+*   built without the decoders (NNINTERP_IMAGE_DECODER=OFF), every format
+*   is unsupported.
+*
+* @retval 0  success
+* @retval -3 unsupported format
+* @retval -5 broken data
+**/
+/**************************************************************************{{{*/
+int
+decode_image(const uint8_t* data, size_t size, std::function<float(int, int)> reduce, DecodedImage& image)
+{
+#ifndef USE_JPEG
+    (void)reduce;
+#endif
+#if !defined(USE_JPEG) && !defined(USE_PNG) && !defined(USE_STB)
+    (void)image;
+#endif
+
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+#if defined(USE_JPEG)
+        return decode_jpeg(data, size, reduce, image);
+#elif defined(USE_STB)
+        return decode_stb(data, size, image);
+#endif
+    }
+    else if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+#if defined(USE_PNG)
+        return decode_png(data, size, image);
+#elif defined(USE_STB)
+        return decode_stb(data, size, image);
+#endif
+    }
+
+    return -3;
+}
+
+/*** decode_image.cpp *****************************************************}}}*/
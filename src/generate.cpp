@@ -0,0 +1,366 @@
+/***  File Header  ************************************************************/
+/**
+* generate.cpp
+*
+* Tiny ML autoregressive generation loop
+* @author      Shozo Fukuda
+* @date create Thu Oct 22 09:26:51 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+
+#include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "preprocess.h"
+#include "stream.h"
+#include "generate.h"
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* make the input tensor in the shape
+* @par DESCRIPTION
+*   the backend is asked to resize only if the shape differs.
+*
+**/
+/**************************************************************************{{{*/
+static bool
+reshape_input(TinyMLInterp* interp, unsigned int index, const std::vector<int64_t>& shape)
+{
+    TensorView view;
+    if (!interp->get_input_buffer(index, view)) {
+        return false;
+    }
+    return (view.mShape == shape) || interp->resize_input_tensor(index, shape);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* put the integers into the input tensor in its dtype
+**/
+/**************************************************************************{{{*/
+static int
+put_input(TinyMLInterp* interp, unsigned int index, const std::vector<int64_t>& shape, const std::vector<int64_t>& values)
+{
+    TensorView view;
+    if (!reshape_input(interp, index, shape) || !interp->get_input_buffer(index, view)) {
+        return -3;
+    }
+    if (view.count() != values.size()) {
+        return -2;
+    }
+
+    switch (view.mDType) {
+    case TensorSpec::DTYPE_I64:
+        memcpy(view.mData, values.data(), values.size()*sizeof(int64_t));
+        break;
+    case TensorSpec::DTYPE_I32:
+        std::transform(values.begin(), values.end(), reinterpret_cast<int32_t*>(view.mData), [](int64_t v) {
+            return static_cast<int32_t>(v);
+        });
+        break;
+    case TensorSpec::DTYPE_F32:
+        std::transform(values.begin(), values.end(), reinterpret_cast<float*>(view.mData), [](int64_t v) {
+            return static_cast<float>(v);
+        });
+        break;
+    default:
+        return -3;
+    }
+    return 0;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* feed the output tensors back into the input tensors
+* @par DESCRIPTION
+*   the input takes the shape of the output (present -> past key/values).
+*   all the outputs are copied out first, because resizing an input may
+*   re-allocate the outputs (TFLite AllocateTensors).
+*   routes: {output, input}[]
+*
+**/
+/**************************************************************************{{{*/
+int
+feed_back(TinyMLInterp* interp, const std::vector<std::pair<unsigned int, unsigned int>>& routes)
+{
+    std::vector<std::vector<uint8_t>> saved(routes.size());
+    std::vector<std::vector<int64_t>> shape(routes.size());
+    for (size_t i = 0; i < routes.size(); i++) {
+        TensorView src;
+        if (!interp->get_output_buffer(routes[i].first, src)) {
+            return -1;
+        }
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(src.mData);
+        saved[i].assign(data, data + src.mBytes);
+        shape[i] = src.mShape;
+    }
+
+    for (size_t i = 0; i < routes.size(); i++) {
+        TensorView dst;
+        if (!reshape_input(interp, routes[i].second, shape[i]) || !interp->get_input_buffer(routes[i].second, dst)) {
+            return -3;
+        }
+        if (dst.mBytes != saved[i].size()) {
+            return -2;
+        }
+        memcpy(dst.mData, saved[i].data(), saved[i].size());
+    }
+    return 0;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* choose the next token
+* @par DESCRIPTION
+*   greedy: argmax of the logits.
+*   sampling: the top_k highest (0: all) with the temperature, cut to the
+*   smallest set over the probability top_p, then drawn by the weights.
+*
+* @retval token id
+**/
+/**************************************************************************{{{*/
+static int
+next_token(const float* logits, size_t vocab, bool sampling, size_t top_k, float top_p, float temperature, std::mt19937& rng)
+{
+    float best = max_f32(logits, vocab);
+    if (!sampling || temperature <= 0.0f) {
+        return static_cast<int>(std::find(logits, logits + vocab, best) - logits);
+    }
+
+    std::vector<int> idx(vocab);
+    for (size_t i = 0; i < vocab; i++) {
+        idx[i] = static_cast<int>(i);
+    }
+    auto higher = [logits](int a, int b) {
+        return (logits[a] > logits[b]) || (logits[a] == logits[b] && a < b);
+    };
+    size_t k = (top_k > 0) ? std::min(top_k, vocab) : vocab;
+    std::partial_sort(idx.begin(), idx.begin() + k, idx.end(), higher);
+    idx.resize(k);
+
+    std::vector<double> weight(k);
+    double sum = 0.0;
+    for (size_t i = 0; i < k; i++) {
+        weight[i] = exp((logits[idx[i]] - best)/temperature);
+        sum += weight[i];
+    }
+
+    if (top_p > 0.0f && top_p < 1.0f) {
+        double cum = 0.0;
+        for (size_t i = 0; i < k; i++) {
+            cum += weight[i];
+            if (cum >= top_p*sum) {
+                k   = i + 1;
+                sum = cum;
+                break;
+            }
+        }
+    }
+
+    double r = std::uniform_real_distribution<double>(0.0, sum)(rng);
+    for (size_t i = 0; i < k; i++) {
+        r -= weight[i];
+        if (r < 0.0) {
+            return idx[i];
+        }
+    }
+    return idx[k-1];
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* autoregressive generation
+* @par DESCRIPTION
+*   run the decoder step by step inside the process: feed the prompt, pick
+*   the next token from the logits of the last position and feed it back
+*   with the present key/values of the model as the past ones, until a
+*   stop token or max_tokens.
+*   without the key/values (num_past 0), the whole sequence is fed every
+*   step. the inputs other than ids/mask/position/past keep the contents
+*   set before (e.g. the encoder states of seq2seq).
+*
+*   ids_input:      input ids [1, S]
+*   mask_input:     attention mask [1, past + S] of ones (-1: none)
+*   position_input: position ids [1, S] (-1: none)
+*   logits_output:  logits [1, S, V] or [1, V]
+*   flags:
+*     1: sampling by top_k/top_p/temperature (otherwise greedy)
+*   seed:      seed of the sampling (0: random)
+*   stream:    send {"partial":[ids..]} every "stream" tokens (0: none)
+*   past_axis: the sequence axis of the past key/values, empty at first
+*   data: {past input, present output}[num_past], stop ids[num_stop],
+*         prompt ids[num_prompt]
+*
+* @retval json {"status":0, "ids":[generated ids..], "stop":"eos"|"length"}
+**/
+/**************************************************************************{{{*/
+std::string
+generate(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int ids_input;
+        int          mask_input;
+        int          position_input;
+        unsigned int logits_output;
+        unsigned int flags;
+        unsigned int max_tokens;
+        unsigned int top_k;
+        float        top_p;
+        float        temperature;
+        unsigned int seed;
+        unsigned int stream;
+        unsigned int past_axis;
+        unsigned int num_past;
+        unsigned int num_stop;
+        unsigned int num_prompt;
+        uint8_t      data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    auto error = [](int status) {
+        json res;
+        res["status"] = status;
+        return res.dump();
+    };
+
+    TinyMLInterp* interp = sys.mInterp;
+    const int32_t* ptr = reinterpret_cast<const int32_t*>(prms->data);
+    std::vector<std::pair<unsigned int, unsigned int>> past;     // {output, input}
+    for (unsigned int i = 0; i < prms->num_past; i++, ptr += 2) {
+        past.emplace_back(ptr[1], ptr[0]);
+    }
+    std::vector<int64_t> stop(ptr, ptr + prms->num_stop);
+    ptr += prms->num_stop;
+    std::vector<int64_t> tokens(ptr, ptr + prms->num_prompt);
+
+    const size_t inputs = interp->InputCount();
+    if (prms->ids_input >= inputs
+    ||  (prms->mask_input >= 0 && static_cast<size_t>(prms->mask_input) >= inputs)
+    ||  (prms->position_input >= 0 && static_cast<size_t>(prms->position_input) >= inputs)
+    ||  prms->logits_output >= interp->OutputCount()
+    ||  tokens.empty()) {
+        return error(-1);
+    }
+
+    // the decoding images are written into the inputs
+    if (!wait_input_image()) {
+        return error(-5);
+    }
+
+    for (const auto& kv : past) {
+        TensorView view;
+        if (kv.second >= inputs || kv.first >= interp->OutputCount() || !interp->get_input_buffer(kv.second, view)) {
+            return error(-1);
+        }
+        if (prms->past_axis >= view.mShape.size()) {
+            return error(-3);
+        }
+        // empty past at the first step
+        view.mShape[prms->past_axis] = 0;
+        if (!reshape_input(interp, kv.second, view.mShape)) {
+            return error(-3);
+        }
+    }
+
+    sys.start_watch();
+
+    std::mt19937 rng(prms->seed ? prms->seed : std::random_device()());
+    const bool   sampling = (prms->flags & 1) != 0;
+    const size_t prompt   = tokens.size();
+    size_t       cached   = 0;      // tokens in the past key/values
+    size_t       streamed = prompt;
+    std::string  stop_reason = "length";
+    std::vector<float> wide;
+
+    for (unsigned int n = 0; n < prms->max_tokens; n++) {
+        // this step: the tokens not in the past key/values
+        std::vector<int64_t> step(tokens.begin() + cached, tokens.end());
+        const int64_t len = static_cast<int64_t>(step.size());
+
+        int status = put_input(interp, prms->ids_input, { 1, len }, step);
+        if (status == 0 && prms->mask_input >= 0) {
+            std::vector<int64_t> ones(cached + len, 1);
+            status = put_input(interp, prms->mask_input, { 1, static_cast<int64_t>(cached) + len }, ones);
+        }
+        if (status == 0 && prms->position_input >= 0) {
+            std::vector<int64_t> pos(len);
+            for (int64_t i = 0; i < len; i++) {
+                pos[i] = static_cast<int64_t>(cached) + i;
+            }
+            status = put_input(interp, prms->position_input, { 1, len }, pos);
+        }
+        if (status != 0) {
+            return error(status);
+        }
+
+        if (!invoke_stream(interp)) {
+            return error(-11);
+        }
+
+        // logits of the last position
+        TensorView view;
+        if (!interp->get_output_buffer(prms->logits_output, view) || view.mShape.size() < 2) {
+            return error(-1);
+        }
+        const size_t rank  = view.mShape.size();
+        const size_t vocab = static_cast<size_t>(view.mShape[rank-1]);
+        const size_t rows  = (rank >= 3) ? static_cast<size_t>(view.mShape[rank-2]) : view.count()/vocab;
+        const float* logits;
+        if (view.mDType == TensorSpec::DTYPE_F32) {
+            logits = reinterpret_cast<const float*>(view.mData) + (rows - 1)*vocab;
+        }
+        else if (view.mDType == TensorSpec::DTYPE_F16) {
+            wide.resize(vocab);
+            f16_to_f32(wide.data(), reinterpret_cast<const uint8_t*>(view.mData) + 2*(rows - 1)*vocab, vocab);
+            logits = wide.data();
+        }
+        else {
+            return error(-3);
+        }
+
+        int64_t token = next_token(logits, vocab, sampling, prms->top_k, prms->top_p, prms->temperature, rng);
+        tokens.push_back(token);
+
+        if (!past.empty()) {
+            if ((status = feed_back(interp, past)) != 0) {
+                return error(status);
+            }
+            cached += len;
+        }
+
+        bool last = (std::find(stop.begin(), stop.end(), token) != stop.end());
+        if (last) {
+            stop_reason = "eos";
+        }
+
+        if (prms->stream > 0 && (tokens.size() - streamed >= prms->stream || last || n + 1 == prms->max_tokens)) {
+            json partial;
+            partial["partial"] = std::vector<int64_t>(tokens.begin() + streamed, tokens.end());
+            if (sys.mSnd(partial.dump()) <= 0) {
+                break;
+            }
+            streamed = tokens.size();
+        }
+
+        if (last) {
+            break;
+        }
+    }
+
+    sys.LAP_EXEC();
+
+    json res;
+    res["status"] = 0;
+    res["ids"]    = std::vector<int64_t>(tokens.begin() + prompt, tokens.end());
+    res["stop"]   = stop_reason;
+    return res.dump();
+}
+
+/*** generate.cpp *********************************************************}}}*/
@@ -0,0 +1,21 @@
+/***  File Header  ************************************************************/
+/**
+* generate.h
+*
+* Tiny ML autoregressive generation loop
+* @author      Shozo Fukuda
+* @date create Thu Oct 22 09:26:51 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _GENERATE_H
+#define _GENERATE_H
+
+/**************************************************************************}}}**
+*
+***************************************************************************{{{*/
+int feed_back(TinyMLInterp* interp, const std::vector<std::pair<unsigned int, unsigned int>>& routes);
+
+std::string generate(SysInfo& sys, const void* args);
+
+#endif /* _GENERATE_H */
@@ -0,0 +1,240 @@
+/***  File Header  ************************************************************/
+/**
+* keypoint.cpp
+*
+* Tiny ML post processing libraies: keypoint heatmaps
+* @author      Shozo Fukuda
+* @date create Wed Oct 21 10:18:35 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "thread_pool.h"
+#include "postprocess.h"
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* peak of a heatmap
+**/
+/**************************************************************************{{{*/
+struct Peak {
+    float mScore;
+    float mX;               // heatmap coordinates with the sub-pixel offset
+    float mY;
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* sub-pixel offset by the quadratic fit
+* @par DESCRIPTION
+*   vertex of the parabola through (-1, l), (0, c), (1, r), within +-0.5.
+*
+**/
+/**************************************************************************{{{*/
+static inline float
+quadratic_offset(float l, float c, float r)
+{
+    float den = l - 2.0f*c + r;
+    if (den >= 0.0f) {
+        return 0.0f;
+    }
+    return std::min(std::max(0.5f*(l - r)/den, -0.5f), 0.5f);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* peaks of a heatmap
+* @par DESCRIPTION
+*   a pixel is a peak if it is the maximum of its 3x3 neighborhood (3x3 max
+*   pooling done by the separable passes) and above the threshold. the
+*   peaks are sorted by the score and refined by the quadratic fit.
+*   max_peaks: 0 takes all.
+*
+**/
+/**************************************************************************{{{*/
+static void
+find_peaks(const float* x, size_t width, size_t height, float threshold, size_t max_peaks, std::vector<Peak>& peaks)
+{
+    // horizontal pass: the row is padded by its edges
+    std::vector<float> hmax(width*height), pad(width + 2), vmax(width);
+    for (size_t y = 0; y < height; y++) {
+        const float* row = x + y*width;
+        pad[0] = row[0];
+        memcpy(&pad[1], row, width*sizeof(float));
+        pad[width+1] = row[width-1];
+        max3_f32(&hmax[y*width], &pad[0], &pad[1], &pad[2], width);
+    }
+
+    // vertical pass and the peaks
+    peaks.clear();
+    for (size_t y = 0; y < height; y++) {
+        const float* up   = &hmax[(y > 0 ? y - 1 : y)*width];
+        const float* down = &hmax[(y + 1 < height ? y + 1 : y)*width];
+        max3_f32(vmax.data(), up, &hmax[y*width], down, width);
+
+        const float* row = x + y*width;
+        for (size_t i = 0; i < width; i++) {
+            if (row[i] > threshold && row[i] >= vmax[i]) {
+                peaks.push_back({ row[i], static_cast<float>(i), static_cast<float>(y) });
+            }
+        }
+    }
+
+    std::stable_sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b) {
+        return a.mScore > b.mScore;
+    });
+    if (max_peaks > 0 && peaks.size() > max_peaks) {
+        peaks.resize(max_peaks);
+    }
+
+    for (auto& p : peaks) {
+        size_t i = static_cast<size_t>(p.mX), y = static_cast<size_t>(p.mY);
+        const float* c = x + y*width + i;
+        if (i > 0 && i + 1 < width) {
+            p.mX += quadratic_offset(c[-1], c[0], c[1]);
+        }
+        if (y > 0 && y + 1 < height) {
+            p.mY += quadratic_offset(c[-static_cast<ptrdiff_t>(width)], c[0], c[width]);
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* keypoints of the heatmaps
+* @par DESCRIPTION
+*   find the peaks of every channel of the output tensor [.., K, H, W] (or
+*   [.., H, W, K] with flags 1) in parallel. only the first image of a
+*   batch. max_peaks 1 takes the argmax of every keypoint (single person).
+*   flags:
+*     1: channels last (NHWC)
+*     2: sigmoid on the scores (the threshold is in the probability)
+*     4: map the keypoints to the original image by the letterbox of the
+*        last preprocessed image.
+*   in_width/in_height: the model input covered by the heatmaps (0: the
+*   size of the heatmaps). x/y are in the model input (or the original
+*   image with flags 4), at the pixel centers.
+*
+* @retval json {"status":0, "keypoints":[[k, x, y, score]..]} in the order
+*              of the channel and the score.
+**/
+/**************************************************************************{{{*/
+std::string
+keypoint_peaks(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int index;
+        unsigned int flags;
+        unsigned int max_peaks;
+        float        threshold;
+        unsigned int in_width;
+        unsigned int in_height;
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    auto error = [](int status) {
+        json res;
+        res["status"] = status;
+        return res.dump();
+    };
+
+    TensorView view;
+    if (prms->index >= sys.mInterp->OutputCount() || !sys.mInterp->get_output_buffer(prms->index, view)) {
+        return error(-1);
+    }
+    if ((view.mDType != TensorSpec::DTYPE_F32 && view.mDType != TensorSpec::DTYPE_F16)
+    ||  view.mShape.size() < 3) {
+        return error(-3);
+    }
+    if ((prms->flags & 4) && !sys.mLetterbox.mValid) {
+        return error(-3);
+    }
+
+    const size_t rank   = view.mShape.size();
+    const bool   nhwc   = (prms->flags & 1) != 0;
+    const size_t chs    = static_cast<size_t>(nhwc ? view.mShape[rank-1] : view.mShape[rank-3]);
+    const size_t height = static_cast<size_t>(nhwc ? view.mShape[rank-3] : view.mShape[rank-2]);
+    const size_t width  = static_cast<size_t>(nhwc ? view.mShape[rank-2] : view.mShape[rank-1]);
+    const size_t plane  = height*width;
+    if (chs == 0 || plane == 0) {
+        return error(-3);
+    }
+
+    // sigmoid is monotonic: the threshold goes to the logit
+    const bool  sig = (prms->flags & 2) != 0;
+    const float thr = !sig ? prms->threshold
+                    : (prms->threshold <= 0.0f) ? -INFINITY
+                    : (prms->threshold >= 1.0f) ? INFINITY
+                    : logf(prms->threshold/(1.0f - prms->threshold));
+
+    const bool is_f16 = (view.mDType == TensorSpec::DTYPE_F16);
+    std::vector<float> wide(is_f16 && nhwc ? plane*chs : 0);
+    if (is_f16 && nhwc) {
+        f16_to_f32(wide.data(), reinterpret_cast<const uint8_t*>(view.mData), plane*chs);
+    }
+    const float*   src  = wide.empty() ? reinterpret_cast<const float*>(view.mData) : wide.data();
+    const uint8_t* half = reinterpret_cast<const uint8_t*>(view.mData);
+
+    std::vector<std::vector<Peak>> result(chs);
+    thread_pool().parallel_for(chs, [&](size_t begin, size_t end) {
+        std::vector<float> buf;
+        for (size_t k = begin; k < end; k++) {
+            const float* x;
+            if (nhwc) {
+                buf.resize(plane);
+                for (size_t p = 0; p < plane; p++) {
+                    buf[p] = src[p*chs + k];
+                }
+                x = buf.data();
+            }
+            else if (is_f16) {
+                buf.resize(plane);
+                f16_to_f32(buf.data(), half + 2*k*plane, plane);
+                x = buf.data();
+            }
+            else {
+                x = src + k*plane;
+            }
+
+            find_peaks(x, width, height, thr, prms->max_peaks, result[k]);
+        }
+    }, 1);
+
+    // heatmap -> model input: (h + 0.5)*ratio, -> image: (m - offset)/scale
+    double ratio_x = prms->in_width  ? static_cast<double>(prms->in_width)/width   : 1.0;
+    double ratio_y = prms->in_height ? static_cast<double>(prms->in_height)/height : 1.0;
+    double scale_x = 1.0, scale_y = 1.0, offset_x = 0.0, offset_y = 0.0;
+    if (prms->flags & 4) {
+        const auto& lb = sys.mLetterbox;
+        scale_x  = lb.mScaleX;
+        scale_y  = lb.mScaleY;
+        offset_x = lb.mOffsetX;
+        offset_y = lb.mOffsetY;
+    }
+
+    json res;
+    res["status"]    = 0;
+    res["keypoints"] = json::array();
+    for (size_t k = 0; k < chs; k++) {
+        for (const auto& p : result[k]) {
+            double x = ((p.mX + 0.5)*ratio_x - offset_x)/scale_x;
+            double y = ((p.mY + 0.5)*ratio_y - offset_y)/scale_y;
+            float  score = sig ? 1.0f/(1.0f + expf(-p.mScore)) : p.mScore;
+            res["keypoints"].push_back({ k, x, y, score });
+        }
+    }
+
+    sys.LAP_OUTPUT();
+
+    return res.dump();
+}
+
+/*** keypoint.cpp *********************************************************}}}*/
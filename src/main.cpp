@@ -40,6 +40,9 @@ void usage()
       << "\toption:\n"
       << "\t  -i <spec> : input tensor spec - \"f4,1,3,224,224\"\n"
       << "\t  -o <spec> : output tensor spec - \"f4,1,1000\"\n"
+      << "\t              specs of each method are given as \"name=<spec>;name=<spec>\"\n"
+      << "\t  -t <kind>:<path> : tokenizer - clip:<merges>, wordpiece:<vocab> or wordpiece_cased:<vocab>\n"
+      << "\t  -s <MB>  : capacity of the tensor store (default 256)\n"
       << "\t  -d <num> : diagnosis mode\n"
       << "\t             1 = save the formed image\n"
       << "\t             2 = save model's input/output tensors\n"
@@ -62,6 +65,8 @@ main(int argc, char* argv[])
 	const struct option longopts[] = {
 	    {"inputs",   required_argument, NULL, 'i'},
 	    {"outputs",  required_argument, NULL, 'o'},
+	    {"tokenizer", required_argument, NULL, 't'},
+	    {"store",    required_argument, NULL, 's'},
 		{"debug",    required_argument, NULL, 'd'},
         {"parallel", required_argument, NULL, 'j'},
 		{0,0,0,0}
@@ -70,13 +75,14 @@ main(int argc, char* argv[])
     // initialize system environment
     gSys.mDiag      = 0;
     gSys.mNumThread = 4;
+    gSys.mStoreLimit = 256u << 20;
     gSys.reset_lap();
     
     std::string inputs;
     std::string outputs;
 
 	for (;;) {
-		opt = getopt_long(argc, argv, "i:o:d:j:", longopts, NULL);
+		opt = getopt_long(argc, argv, "i:o:t:s:d:j:", longopts, NULL);
 		if (opt == -1) {
 			break;
 		}
@@ -87,6 +93,12 @@ main(int argc, char* argv[])
 		case 'o':
 		    outputs = optarg;
 		    break;
+		case 't':
+		    gSys.mTokenizer = optarg;
+		    break;
+		case 's':
+		    gSys.mStoreLimit = static_cast<size_t>(atol(optarg)) << 20;
+		    break;
 		case 'd':
 			break;
         case 'j':
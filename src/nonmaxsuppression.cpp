@@ -11,110 +11,654 @@
 /**************************************************************************{{{*/
 
 #include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "thread_pool.h"
 #include "postprocess.h"
 
-#include <list>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
 
 /***  Class Header  *******************************************************}}}*/
 /**
-* bounding box
-* @par DESCRIPTION
-*   it holds bbox and score needed for NMS and provides IOU function.
-**/
-/**************************************************************************{{{*/
-class Box {
-//LIFECYCLE:
-public:
-    Box(unsigned int index, const float box[4], float score, unsigned int box_repr=0) {
-        mIndex = index;
-
-        switch (box_repr) {
-        case 2:
-            mBBox[0] = box[0];
-            mBBox[1] = box[1];
-            mBBox[2] = box[2];
-            mBBox[3] = box[3];
-            mArea = (box[2]-box[0])*(box[3]-box[1]);
-            break;
-
-        case 1:
-            mBBox[0] = box[0];
-            mBBox[1] = box[1];
-            mBBox[2] = box[0] + box[2];
-            mBBox[3] = box[1] + box[3];
-            mArea = box[2]*box[3];
-            break;
-
-        case 0:
-        default:
-            mBBox[0] = static_cast<float>(box[0] - box[2]/2.0);
-            mBBox[1] = static_cast<float>(box[1] - box[3]/2.0);
-            mBBox[2] = static_cast<float>(box[0] + box[2]/2.0);
-            mBBox[3] = static_cast<float>(box[1] + box[3]/2.0);
-            mArea = box[2]*box[3];
-            break;
-        }
-        
-        mScore = score;
-    }
-
-//ACTION:
-public:
-    // calc Intersection over Union
-    float iou(const Box& x) const {
-        float x1 = std::max(mBBox[0], x.mBBox[0]);
-        float y1 = std::max(mBBox[1], x.mBBox[1]);
-        float x2 = std::min(mBBox[2], x.mBBox[2]);
-        float y2 = std::min(mBBox[3], x.mBBox[3]);
-        
-        if (x1 < x2 && y1 < y2) {
-            float v_intersection = (x2 - x1)*(y2 - y1);
-            float v_union        = mArea + x.mArea - v_intersection;
-            return v_intersection/v_union;
-        }
-        else {
-            return 0.0;
-        }
-    }
-
-    // Comparison operation
-    bool less(const Box& b) const {
-        return mScore < b.mScore;
-    }
-
-    // put out the scaled BBox in JSON formatting
-    json to_json() const {
-        auto result = json::array();
-        result.push_back(mScore);
-        result.push_back(mBBox[0]);
-        result.push_back(mBBox[1]);
-        result.push_back(mBBox[2]);
-        result.push_back(mBBox[3]);
-        result.push_back(mIndex);
-        return result;
-    }
-
-//ACCESSOR:
-public:
-    void set_score(float score) {
-        mScore = score;
-    }
-    
-    float get_score() {
-        return mScore;
-    }
-
-//ATTRIBUTE:
-protected:
-    unsigned int  mIndex;
-    float         mBBox[4];
-    float         mArea;
-    float         mScore;
+* bounding boxes
+* @par DESCRIPTION
+*   structure of arrays of the corner coordinates and the areas. the boxes
+*   are converted once and shared by all classes.
+**/
+/**************************************************************************{{{*/
+struct BoxArray {
+    std::vector<float> mX1, mY1, mX2, mY2, mArea;
+
+    BoxArray(unsigned int num_boxes, unsigned int box_repr, const float* boxes) :
+        mX1(num_boxes), mY1(num_boxes), mX2(num_boxes), mY2(num_boxes), mArea(num_boxes)
+    {
+        for (unsigned int i = 0; i < num_boxes; i++, boxes += 4) {
+            const float* box = boxes;
+            switch (box_repr) {
+            case 2:
+                mX1[i] = box[0];
+                mY1[i] = box[1];
+                mX2[i] = box[2];
+                mY2[i] = box[3];
+                mArea[i] = (box[2]-box[0])*(box[3]-box[1]);
+                break;
+
+            case 1:
+                mX1[i] = box[0];
+                mY1[i] = box[1];
+                mX2[i] = box[0] + box[2];
+                mY2[i] = box[1] + box[3];
+                mArea[i] = box[2]*box[3];
+                break;
+
+            case 0:
+            default:
+                mX1[i] = static_cast<float>(box[0] - box[2]/2.0);
+                mY1[i] = static_cast<float>(box[1] - box[3]/2.0);
+                mX2[i] = static_cast<float>(box[0] + box[2]/2.0);
+                mY2[i] = static_cast<float>(box[1] + box[3]/2.0);
+                mArea[i] = box[2]*box[3];
+                break;
+            }
+        }
+    }
+};
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* NMS parameters
+**/
+/**************************************************************************{{{*/
+struct NmsParams {
+    float        mIouThreshold;
+    float        mScoreThreshold;
+    float        mSigma;            // > 0: soft-NMS / gaussian Matrix-NMS
+    unsigned int mMaxCandidates;    // candidates per class, 0: all
+    unsigned int mMaxDetections;    // detections per image, 0: all
+    bool         mAgnostic;         // suppress across the classes
+    unsigned int mMethod;           // NMS_AUTO, NMS_DENSE or NMS_GRID
+    unsigned int mAlgorithm;        // NMS_GREEDY, NMS_FAST or NMS_MATRIX
 };
 
-// Comparison operator for Boxes
-bool operator< (const Box& a, const Box& b) {
-    return a.less(b);
+enum {
+    NMS_AUTO = 0,
+    NMS_DENSE,                      // IoU against all the lower candidates
+    NMS_GRID,                       // IoU against the candidates in the same grid cells
+};
+
+enum {
+    NMS_GREEDY = 0,                 // hard/soft NMS
+    NMS_FAST,                       // Fast-NMS
+    NMS_MATRIX,                     // Matrix-NMS
+};
+
+/*--- CONSTANT ---*/
+const size_t GRID_MIN   = 256;      // candidates per class from which NMS_AUTO uses the grid
+const int    GRID_CELLS = 512;      // max cells along an axis
+const size_t MATRIX_TOPK = 1024;    // default candidates per class of Fast/Matrix-NMS
+const size_t MATRIX_KEEP = 2048;    // up to this, the IoU matrix is kept (16MB)
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* back-mapping to the original image
+* @par DESCRIPTION
+*   image_xy = (model_xy - offset)/scale, clamped into the image. a box
+*   without area after the clamping is removed.
+**/
+/**************************************************************************{{{*/
+PACK(
+struct BoxMapping {
+    float scale_x;
+    float scale_y;
+    float offset_x;
+    float offset_y;
+    int   width;                // size of the original image
+    int   height;
+});
+
+static BoxMapping
+mapping_of(const SysInfo::Letterbox& letterbox)
+{
+    BoxMapping mapping = {
+        letterbox.mScaleX, letterbox.mScaleY,
+        letterbox.mOffsetX, letterbox.mOffsetY,
+        letterbox.mWidth, letterbox.mHeight
+    };
+    return mapping;
+}
+
+// map the box in place. false if it vanishes.
+static inline bool
+map_box(const BoxMapping& mapping, float& x1, float& y1, float& x2, float& y2)
+{
+    const float w = static_cast<float>(mapping.width);
+    const float h = static_cast<float>(mapping.height);
+    x1 = std::min(std::max((x1 - mapping.offset_x)/mapping.scale_x, 0.0f), w);
+    y1 = std::min(std::max((y1 - mapping.offset_y)/mapping.scale_y, 0.0f), h);
+    x2 = std::min(std::max((x2 - mapping.offset_x)/mapping.scale_x, 0.0f), w);
+    y2 = std::min(std::max((y2 - mapping.offset_y)/mapping.scale_y, 0.0f), h);
+    return (x1 < x2) && (y1 < y2);
+}
+
+typedef std::pair<float, unsigned int> Scored;     // {score, box}
+
+// higher score first, and the later box first on a tie
+static inline bool
+higher(const Scored& a, const Scored& b)
+{
+    return (a.first > b.first) || (a.first == b.first && a.second > b.second);
+}
+
+// IoU of two boxes given by the corners and the area
+static inline float
+overlap(float ax1, float ay1, float ax2, float ay2, float aa, float bx1, float by1, float bx2, float by2, float ba)
+{
+    float ix1 = std::max(ax1, bx1);
+    float iy1 = std::max(ay1, by1);
+    float ix2 = std::min(ax2, bx2);
+    float iy2 = std::min(ay2, by2);
+    float inter = (ix2 - ix1)*(iy2 - iy1);
+    float v     = inter/(aa + ba - inter);
+    return (ix1 < ix2 && iy1 < iy2) ? v : 0.0f;
+}
+
+// grid cell of the scaled coordinate v (NaN goes to the cell 0)
+static inline int
+cell_of(float v, int n)
+{
+    return (v >= 0.0f) ? ((v < n) ? static_cast<int>(v) : n - 1) : 0;
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* candidates of a class
+* @par DESCRIPTION
+*   contiguous coordinates of the candidates for the vectorized IoU, and
+*   an optional uniform grid: every candidate is listed in all the cells
+*   it covers, so two overlapping boxes always share a cell.
+**/
+/**************************************************************************{{{*/
+struct ClassBoxes {
+    std::vector<float> mX1, mY1, mX2, mY2, mArea;
+
+    float mLeft, mTop, mScaleX, mScaleY;    // coordinate -> cell
+    int   mCols, mRows;
+    std::vector<unsigned int> mCellStart;   // slots of cell k: mCellSlot[mCellStart[k]..mCellStart[k+1])
+    std::vector<unsigned int> mCellSlot;
+    std::vector<unsigned int> mStamp;       // last box which visited the slot
+
+    void gather(const BoxArray& boxes, const std::vector<Scored>& cand) {
+        size_t n = cand.size();
+        mX1.resize(n); mY1.resize(n); mX2.resize(n); mY2.resize(n); mArea.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            unsigned int b = cand[i].second;
+            mX1[i] = boxes.mX1[b];
+            mY1[i] = boxes.mY1[b];
+            mX2[i] = boxes.mX2[b];
+            mY2[i] = boxes.mY2[b];
+            mArea[i] = boxes.mArea[b];
+        }
+    }
+
+    // iou[j] = IoU(box s, box j) for j in [begin, end)
+    void iou(size_t s, size_t begin, size_t end, float* iou) const {
+        const float sx1 = mX1[s], sy1 = mY1[s], sx2 = mX2[s], sy2 = mY2[s], sa = mArea[s];
+        const float* x1 = mX1.data();
+        const float* y1 = mY1.data();
+        const float* x2 = mX2.data();
+        const float* y2 = mY2.data();
+        const float* area = mArea.data();
+        for (size_t j = begin; j < end; j++) {
+            iou[j] = overlap(sx1, sy1, sx2, sy2, sa, x1[j], y1[j], x2[j], y2[j], area[j]);
+        }
+    }
+
+    float iou(size_t s, size_t j) const {
+        return overlap(mX1[s], mY1[s], mX2[s], mY2[s], mArea[s], mX1[j], mY1[j], mX2[j], mY2[j], mArea[j]);
+    }
+
+    // the cell size is about the mean box size, with at most 4 cells per candidate.
+    void build_grid() {
+        size_t n = mX1.size();
+        float  left = mX1[0], top = mY1[0], right = mX2[0], bottom = mY2[0];
+        double sum_w = 0.0, sum_h = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            left   = std::min(left,   mX1[i]);
+            top    = std::min(top,    mY1[i]);
+            right  = std::max(right,  mX2[i]);
+            bottom = std::max(bottom, mY2[i]);
+            sum_w += std::max(mX2[i] - mX1[i], 0.0f);
+            sum_h += std::max(mY2[i] - mY1[i], 0.0f);
+        }
+
+        double cols = (sum_w > 0.0) ? n*(right - left)/sum_w : 1.0;
+        double rows = (sum_h > 0.0) ? n*(bottom - top)/sum_h : 1.0;
+        cols = std::min(std::max(cols, 1.0), static_cast<double>(GRID_CELLS));
+        rows = std::min(std::max(rows, 1.0), static_cast<double>(GRID_CELLS));
+        if (cols*rows > 4.0*n) {
+            double shrink = sqrt(cols*rows/(4.0*n));
+            cols = std::max(cols/shrink, 1.0);
+            rows = std::max(rows/shrink, 1.0);
+        }
+        mCols   = static_cast<int>(cols);
+        mRows   = static_cast<int>(rows);
+        mLeft   = left;
+        mTop    = top;
+        mScaleX = (right > left)  ? mCols/(right - left)  : 0.0f;
+        mScaleY = (bottom > top) ? mRows/(bottom - top) : 0.0f;
+
+        // count and fill the slots of every cell
+        mCellStart.assign(mCols*mRows + 1, 0);
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t i = 0; i < n; i++) {
+                int c0, r0, c1, r1;
+                cells(i, c0, r0, c1, r1);
+                for (int r = r0; r <= r1; r++) {
+                    for (int c = c0; c <= c1; c++) {
+                        if (pass == 0) {
+                            mCellStart[r*mCols + c + 1]++;
+                        }
+                        else {
+                            mCellSlot[mCellStart[r*mCols + c]++] = static_cast<unsigned int>(i);
+                        }
+                    }
+                }
+            }
+            if (pass == 0) {
+                for (size_t k = 1; k < mCellStart.size(); k++) {
+                    mCellStart[k] += mCellStart[k-1];
+                }
+                mCellSlot.resize(mCellStart.back());
+            }
+        }
+        // the fill pass moved every start to the next cell
+        for (size_t k = mCellStart.size() - 1; k > 0; k--) {
+            mCellStart[k] = mCellStart[k-1];
+        }
+        mCellStart[0] = 0;
+
+        mStamp.assign(n, 0);
+    }
+
+    void cells(size_t s, int& c0, int& r0, int& c1, int& r1) const {
+        c0 = cell_of((mX1[s] - mLeft)*mScaleX, mCols);
+        c1 = cell_of((mX2[s] - mLeft)*mScaleX, mCols);
+        r0 = cell_of((mY1[s] - mTop)*mScaleY, mRows);
+        r1 = cell_of((mY2[s] - mTop)*mScaleY, mRows);
+    }
+
+    // call func(j) once for every candidate j sharing a cell with box s
+    template <class F>
+    void near(size_t s, F func) {
+        int c0, r0, c1, r1;
+        cells(s, c0, r0, c1, r1);
+        const unsigned int stamp = static_cast<unsigned int>(s) + 1;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                for (unsigned int k = mCellStart[r*mCols + c]; k < mCellStart[r*mCols + c + 1]; k++) {
+                    unsigned int j = mCellSlot[k];
+                    if (mStamp[j] != stamp) {
+                        mStamp[j] = stamp;
+                        func(j);
+                    }
+                }
+            }
+        }
+    }
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* Fast-NMS / Matrix-NMS of a class
+* @par DESCRIPTION
+*   take IoU of the sorted candidates at once. row j of the matrix holds
+*   the IoU against the higher candidates 0..j-1, and the rows are computed
+*   in parallel. comp[j] is the max of row j, i.e. how much candidate j is
+*   overlapped by the higher ones. over MATRIX_KEEP candidates the matrix
+*   is not kept: a row is computed again where it is needed, so the memory
+*   is O(n) per thread.
+*   Fast-NMS drops a candidate whose comp reaches iou_threshold.
+*   Matrix-NMS decays every score by the higher candidates, compensated by
+*   how much they are overlapped themselves, and keeps the decayed scores
+*   above score_threshold:
+*     linear   (sigma = 0): min (1 - iou)/(1 - comp)
+*     gaussian (sigma > 0): min exp(-(iou^2 - comp^2)/sigma)
+*
+**/
+/**************************************************************************{{{*/
+static void
+nms_matrix(const ClassBoxes& soa, const std::vector<Scored>& cand, const NmsParams& prms, size_t limit, std::vector<Scored>& kept)
+{
+    const size_t n = cand.size();
+
+    const bool keep = (n <= MATRIX_KEEP);
+    std::vector<float> matrix(keep ? n*n : 0);
+    std::vector<float> comp(n);
+    thread_pool().parallel_for(n, [&](size_t begin, size_t end) {
+        std::vector<float> buf(keep ? 0 : n);
+        for (size_t j = begin; j < end; j++) {
+            float* row = keep ? &matrix[j*n] : buf.data();
+            soa.iou(j, 0, j, row);
+            comp[j] = (j > 0) ? max_f32(row, j) : 0.0f;
+        }
+    }, 16);
+
+    if (prms.mAlgorithm == NMS_FAST) {
+        for (size_t j = 0; j < n && kept.size() < limit; j++) {
+            if (comp[j] < prms.mIouThreshold) {
+                kept.push_back(cand[j]);
+            }
+        }
+        return;
+    }
+
+    std::vector<float> score(n);
+    thread_pool().parallel_for(n, [&](size_t begin, size_t end) {
+        std::vector<float> x(n), buf(keep ? 0 : n);
+        for (size_t j = begin; j < end; j++) {
+            const float* row = keep ? &matrix[j*n] : buf.data();
+            if (!keep) {
+                soa.iou(j, 0, j, buf.data());
+            }
+            float decay = 1.0f;
+            if (prms.mSigma > 0.0f) {
+                // exp is monotonic: decay by the largest exponent
+                for (size_t i = 0; i < j; i++) {
+                    x[i] = row[i]*row[i] - comp[i]*comp[i];
+                }
+                decay = (j > 0) ? expf(-max_f32(x.data(), j)/prms.mSigma) : 1.0f;
+            }
+            else {
+                for (size_t i = 0; i < j; i++) {
+                    decay = std::min(decay, (1.0f - row[i])/(1.0f - comp[i]));
+                }
+            }
+            score[j] = cand[j].first*decay;
+        }
+    }, 16);
+
+    for (size_t j = 0; j < n; j++) {
+        if (score[j] > prms.mScoreThreshold) {
+            kept.emplace_back(score[j], cand[j].second);
+        }
+    }
+    std::sort(kept.begin(), kept.end(), higher);
+    if (kept.size() > limit) {
+        kept.resize(limit);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* NMS of a class
+* @par DESCRIPTION
+*   sort the candidates once and suppress by the vectorized IoU. soft-NMS
+*   keeps the decayed candidates in a heap with lazy deletion.
+*   for a large set of candidates, NMS_GRID computes IoU only against the
+*   candidates sharing a grid cell. the result is the same as NMS_DENSE as
+*   long as iou_threshold > 0.
+*
+**/
+/**************************************************************************{{{*/
+static void
+nms_class(const BoxArray& boxes, std::vector<Scored>& cand, const NmsParams& prms, std::vector<Scored>& kept)
+{
+    kept.clear();
+    if (cand.empty()) {
+        return;
+    }
+
+    // bounded preselection
+    size_t max_cand = prms.mMaxCandidates;
+    if (max_cand == 0 && prms.mAlgorithm != NMS_GREEDY) {
+        max_cand = MATRIX_TOPK;
+    }
+    if (max_cand > 0 && cand.size() > max_cand) {
+        std::nth_element(cand.begin(), cand.begin() + max_cand, cand.end(), higher);
+        cand.resize(max_cand);
+    }
+    std::sort(cand.begin(), cand.end(), higher);
+
+    const size_t n     = cand.size();
+    const size_t limit = (prms.mMaxDetections > 0) ? prms.mMaxDetections : n;
+
+    ClassBoxes soa;
+    soa.gather(boxes, cand);
+
+    if (prms.mAlgorithm != NMS_GREEDY) {
+        nms_matrix(soa, cand, prms, limit, kept);
+        return;
+    }
+
+    bool grid = (prms.mIouThreshold > 0.0f)
+             && ((prms.mMethod == NMS_GRID) || (prms.mMethod == NMS_AUTO && n >= GRID_MIN));
+    if (grid) {
+        soa.build_grid();
+    }
+    std::vector<float> iou(grid ? 0 : n);
+
+    if (prms.mSigma <= 0.0f && grid) {
+        std::vector<uint8_t> suppressed(n, 0);
+        for (size_t i = 0; i < n && kept.size() < limit; i++) {
+            if (suppressed[i]) {
+                continue;
+            }
+            kept.push_back(cand[i]);
+
+            soa.near(i, [&](size_t j) {
+                if (j > i && !suppressed[j] && soa.iou(i, j) >= prms.mIouThreshold) {
+                    suppressed[j] = 1;
+                }
+            });
+        }
+    }
+    else if (prms.mSigma <= 0.0f) {
+        std::vector<uint8_t> suppressed(n, 0);
+        for (size_t i = 0; i < n && kept.size() < limit; i++) {
+            if (suppressed[i]) {
+                continue;
+            }
+            kept.push_back(cand[i]);
+
+            soa.iou(i, i + 1, n, iou.data());
+            const float thr = prms.mIouThreshold;
+            for (size_t j = i + 1; j < n; j++) {
+                suppressed[j] |= (iou[j] >= thr);
+            }
+        }
+    }
+    else {
+        // heap of {score, slot}; an entry is stale if its score differs from score[slot].
+        std::vector<float>   score(n);
+        std::vector<uint8_t> alive(n, 1);
+        std::vector<std::pair<float, size_t>> heap(n);
+        for (size_t i = 0; i < n; i++) {
+            score[i] = cand[i].first;
+            heap[i]  = std::make_pair(cand[i].first, i);
+        }
+        auto lower = [&cand](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+            return higher(Scored(b.first, cand[b.second].second), Scored(a.first, cand[a.second].second));
+        };
+        std::make_heap(heap.begin(), heap.end(), lower);
+
+        while (!heap.empty() && kept.size() < limit) {
+            std::pop_heap(heap.begin(), heap.end(), lower);
+            auto top = heap.back();
+            heap.pop_back();
+
+            size_t s = top.second;
+            if (!alive[s] || top.first != score[s]) {
+                continue;
+            }
+            alive[s] = 0;
+            kept.emplace_back(score[s], cand[s].second);
+
+            auto decay = [&](size_t j, float v) {
+                if (!alive[j] || v < prms.mIouThreshold) {
+                    return;
+                }
+                float decayed = static_cast<float>(score[j]*exp(static_cast<double>(-(v*v)/prms.mSigma)));
+                if (decayed > prms.mScoreThreshold) {
+                    score[j] = decayed;
+                    heap.emplace_back(decayed, j);
+                    std::push_heap(heap.begin(), heap.end(), lower);
+                }
+                else {
+                    alive[j] = 0;
+                }
+            };
+
+            if (grid) {
+                soa.near(s, [&](size_t j) {
+                    if (alive[j]) {
+                        decay(j, soa.iou(s, j));
+                    }
+                });
+            }
+            else {
+                soa.iou(s, 0, n, iou.data());
+                for (size_t j = 0; j < n; j++) {
+                    decay(j, iou[j]);
+                }
+            }
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* cap the detections of an image
+* @par DESCRIPTION
+*   keep the max_det highest detections over all the classes.
+*
+**/
+/**************************************************************************{{{*/
+static void
+cap_detections(std::vector<std::vector<Scored>>& result, size_t max_det)
+{
+    std::vector<std::pair<Scored, size_t>> all;     // {detection, class}
+    for (size_t c = 0; c < result.size(); c++) {
+        for (const auto& det : result[c]) {
+            all.emplace_back(det, c);
+        }
+    }
+    if (all.size() <= max_det) {
+        return;
+    }
+
+    std::nth_element(all.begin(), all.begin() + max_det, all.end(), [](const std::pair<Scored, size_t>& a, const std::pair<Scored, size_t>& b) {
+        return higher(a.first, b.first) || (a.first == b.first && a.second < b.second);
+    });
+    all.resize(max_det);
+
+    for (auto& dets : result) {
+        dets.clear();
+    }
+    for (const auto& det : all) {
+        result[det.second].push_back(det.first);
+    }
+    for (auto& dets : result) {
+        std::sort(dets.begin(), dets.end(), higher);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* Non Maximum Suppression for Multi Class
+* @par DESCRIPTION
+*   split the scores into the classes in a single pass, then run NMS of
+*   the classes in parallel. in the class agnostic mode, every box takes
+*   part in a single NMS with the score of its best class.
+*
+* @retval detections of every class
+**/
+/**************************************************************************{{{*/
+static void
+nms_multi_class(
+const BoxArray&     boxes,
+unsigned int        num_boxes,
+unsigned int        num_class,
+const float*        scores,
+const NmsParams&    prms,
+std::vector<std::vector<Scored>>& result)
+{
+    result.assign(num_class, std::vector<Scored>());
+
+    if (prms.mAgnostic) {
+        std::vector<Scored>       cand, kept;
+        std::vector<unsigned int> best(num_boxes);
+        for (unsigned int i = 0; i < num_boxes; i++, scores += num_class) {
+            best[i] = static_cast<unsigned int>(std::max_element(scores, scores + num_class) - scores);
+            if (scores[best[i]] > prms.mScoreThreshold) {
+                cand.emplace_back(scores[best[i]], i);
+            }
+        }
+
+        nms_class(boxes, cand, prms, kept);
+        for (const auto& det : kept) {
+            result[best[det.second]].push_back(det);
+        }
+        return;
+    }
+
+    std::vector<std::vector<Scored>> bucket(num_class);
+    for (unsigned int i = 0; i < num_boxes; i++, scores += num_class) {
+        for (unsigned int c = 0; c < num_class; c++) {
+            if (scores[c] > prms.mScoreThreshold) {
+                bucket[c].emplace_back(scores[c], i);
+            }
+        }
+    }
+
+    thread_pool().parallel_for(num_class, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            nms_class(boxes, bucket[c], prms, result[c]);
+        }
+    });
+
+    if (prms.mMaxDetections > 0) {
+        cap_detections(result, prms.mMaxDetections);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* detections in JSON formatting
+* @par DESCRIPTION
+*   {label: [[score, x1, y1, x2, y2, box index]..]..}, null if nothing.
+*   the boxes are mapped back to the original image if mapping is given.
+*   extra[class][n] is appended to the n-th detection of the class if given.
+*
+* @retval json
+**/
+/**************************************************************************{{{*/
+static json
+detections_json(const BoxArray& boxes, const std::vector<std::vector<Scored>>& result, const unsigned int* box_id, const BoxMapping* mapping,
+                const std::vector<std::vector<json>>* extra=nullptr)
+{
+    json res;
+
+    for (unsigned int class_id = 0; class_id < result.size(); class_id++) {
+        json items = json::array();
+        for (size_t n = 0; n < result[class_id].size(); n++) {
+            const Scored& det = result[class_id][n];
+            unsigned int b = det.second;
+            float x1 = boxes.mX1[b], y1 = boxes.mY1[b], x2 = boxes.mX2[b], y2 = boxes.mY2[b];
+            if (mapping && !map_box(*mapping, x1, y1, x2, y2)) {
+                continue;
+            }
+            items.push_back({ det.first, x1, y1, x2, y2, box_id ? box_id[b] : b });
+            if (extra) {
+                items.back().push_back((*extra)[class_id][n]);
+            }
+        }
+        if (items.empty()) continue;
+
+        res[gSys.label(class_id)] = std::move(items);
+    }
+
+    return res;
 }
 
 /***  Module Header  ******************************************************}}}*/
@@ -135,63 +679,17 @@ unsigned int num_class,
 const float* scores,
 float         iou_threshold,
 float         score_threshold,
-float         sigma)
+float         sigma,
+const unsigned int* box_id=nullptr,
+const BoxMapping*   mapping=nullptr)
 {
-    json res;
-    std::list<Box> candidates;
-
-    // run nms over each classification class.
-    for (unsigned int class_id = 0; class_id < num_class; class_id++) {
-        // pick up candidates for focus class
-        const float* _boxes  = boxes;
-        const float* _scores = scores;
-
-        candidates.clear();
-        for (unsigned int i = 0; i < num_boxes; i++, _boxes += 4, _scores += num_class) {
-            if (_scores[class_id] > score_threshold) {
-                candidates.emplace_back(i, _boxes, _scores[class_id], box_repr);
-            }
-        }
-        if (candidates.empty()) continue;
-
-        // perform iou filtering
-        std::string class_name = gSys.label(class_id);
-        bool run_sort = true;
-        do {
-            if (run_sort) {
-                candidates.sort();
-                run_sort = false;
-            }
-
-            Box selected = candidates.back(); candidates.pop_back();
-            res[class_name].push_back(selected.to_json());
-
-            for (auto it = candidates.begin(); it != candidates.end();) {
-                float iou = selected.iou(*it);
-                if (iou >= iou_threshold) {
-                    if (sigma > 0.0) {
-                        float soft_nms_score = it->get_score()*exp(-(iou*iou)/sigma);
-                        if (soft_nms_score > score_threshold) {
-                            it->set_score(soft_nms_score);
-                            run_sort = true;
-                            it++;
-                        }
-                        else {
-                            it = candidates.erase(it);
-                        }
-                    }
-                    else {
-                        it = candidates.erase(it);
-                    }
-                }
-                else {
-                    it++;
-                }
-            }
-        } while (!candidates.empty());
-    }
+    BoxArray  box_array(num_boxes, box_repr, boxes);
+    NmsParams prms = { iou_threshold, score_threshold, sigma, 0, 0, false, NMS_AUTO, NMS_GREEDY };
 
-    return res.dump();
+    std::vector<std::vector<Scored>> result;
+    nms_multi_class(box_array, num_boxes, num_class, scores, prms, result);
+
+    return detections_json(box_array, result, box_id, mapping).dump();
 }
 
 /***  Module Header  ******************************************************}}}*/
@@ -230,4 +728,729 @@ non_max_suppression_multi_class(SysInfo&, const void* args)
     );
 }
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* Batched Non Maximum Suppression
+* @par DESCRIPTION
+*   run NMS on every image of the batch in parallel.
+*   boxes: [num_batch][num_boxes][4], scores: [num_batch][num_boxes][num_class]
+*   flags: 1:class agnostic, 2:dense NMS, 4:grid NMS (automatic if neither),
+*          8:Fast-NMS, 16:Matrix-NMS (greedy hard/soft NMS if neither),
+*          32:BoxMapping[num_batch] precedes the boxes,
+*          64:map by the letterbox of the last preprocessed image
+*
+* @retval json {"status":0, "batch":[{label: [..]..}..]}
+**/
+/**************************************************************************{{{*/
+std::string
+non_max_suppression_batch(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int num_batch;
+        unsigned int num_boxes;
+        unsigned int box_repr;
+        unsigned int num_class;
+        float         iou_threshold;
+        float         score_threshold;
+        float         sigma;
+        unsigned int flags;
+        unsigned int max_candidates;
+        unsigned int max_detections;
+        uint8_t       table[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    const size_t num_batch = prms->num_batch;
+    const size_t num_boxes = prms->num_boxes;
+    const size_t num_class = prms->num_class;
+
+    // box mapping of every image
+    std::vector<BoxMapping> mapping;
+    const uint8_t* table = prms->table;
+    if (prms->flags & 32) {
+        const BoxMapping* src = reinterpret_cast<const BoxMapping*>(table);
+        mapping.assign(src, src + num_batch);
+        table += sizeof(BoxMapping)*num_batch;
+    }
+    else if (prms->flags & 64) {
+        if (!sys.mLetterbox.mValid) {
+            json res;
+            res["status"] = -3;
+            return res.dump();
+        }
+        mapping.assign(num_batch, mapping_of(sys.mLetterbox));
+    }
+
+    const float* boxes  = reinterpret_cast<const float*>(table);
+    const float* scores = boxes + 4*num_batch*num_boxes;
+
+    NmsParams nms = {
+        prms->iou_threshold,
+        prms->score_threshold,
+        prms->sigma,
+        prms->max_candidates,
+        prms->max_detections,
+        (prms->flags & 1) != 0,
+        (prms->flags >> 1) & 3,
+        (prms->flags >> 3) & 3
+    };
+
+    std::vector<json> items(num_batch);
+    thread_pool().parallel_for(num_batch, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            BoxArray box_array(prms->num_boxes, prms->box_repr, boxes + 4*num_boxes*b);
+
+            std::vector<std::vector<Scored>> result;
+            nms_multi_class(box_array, prms->num_boxes, prms->num_class, scores + num_class*num_boxes*b, nms, result);
+
+            items[b] = detections_json(box_array, result, nullptr, mapping.empty() ? nullptr : &mapping[b]);
+        }
+    }, 1);
+
+    json res;
+    res["status"] = 0;
+    res["batch"]  = json::array();
+    for (auto& item : items) {
+        res["batch"].push_back(item.is_null() ? json::object() : item);
+    }
+
+    return res.dump();
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* decoded candidates
+* @par DESCRIPTION
+*   boxes (center, size) and class scores of the anchors passing the score
+*   threshold, with the anchor index.
+**/
+/**************************************************************************{{{*/
+struct Candidates {
+    std::vector<float>        mBoxes;
+    std::vector<float>        mScores;
+    std::vector<unsigned int> mId;
+
+    void append(const Candidates& x) {
+        mBoxes.insert(mBoxes.end(), x.mBoxes.begin(), x.mBoxes.end());
+        mScores.insert(mScores.end(), x.mScores.begin(), x.mScores.end());
+        mId.insert(mId.end(), x.mId.begin(), x.mId.end());
+    }
+};
+
+static inline float
+sigmoid(float x)
+{
+    return 1.0f/(1.0f + expf(-x));
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* get f32 view of the output tensor
+* @par DESCRIPTION
+*   f16 tensor is widened into "buf".
+*
+* @retval pointer to the f32 data, or nullptr
+**/
+/**************************************************************************{{{*/
+static const float*
+output_f32(SysInfo& sys, unsigned int index, std::vector<int64_t>& shape, std::vector<float>& buf)
+{
+    TensorView view;
+    if (index >= sys.mInterp->OutputCount() || !sys.mInterp->get_output_buffer(index, view)) {
+        return nullptr;
+    }
+    shape = view.mShape;
+
+    switch (view.mDType) {
+    case TensorSpec::DTYPE_F32:
+        return reinterpret_cast<const float*>(view.mData);
+    case TensorSpec::DTYPE_F16:
+        buf.resize(view.count());
+        f16_to_f32(buf.data(), reinterpret_cast<const uint8_t*>(view.mData), buf.size());
+        return buf.data();
+    default:
+        return nullptr;
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode rows in parallel
+* @par DESCRIPTION
+*   "func(row, candidates)" decodes a row. the chunks are joined in order.
+**/
+/**************************************************************************{{{*/
+static void
+decode_rows(size_t rows, Candidates& result, std::function<void(size_t, Candidates&)> func)
+{
+    const size_t grain  = 1024;
+    const size_t chunks = (rows + grain - 1)/grain;
+
+    std::vector<Candidates> part(chunks);
+    thread_pool().parallel_for(chunks, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t last = std::min(rows, (c + 1)*grain);
+            for (size_t row = c*grain; row < last; row++) {
+                func(row, part[c]);
+            }
+        }
+    });
+
+    for (const auto& p : part) {
+        result.append(p);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* keep the scores of a row if any passes the threshold
+**/
+/**************************************************************************{{{*/
+static inline void
+keep(Candidates& cand, unsigned int id, const float box[4], const float* scores, unsigned int num_class, float threshold)
+{
+    for (unsigned int c = 0; c < num_class; c++) {
+        if (scores[c] > threshold) {
+            cand.mBoxes.insert(cand.mBoxes.end(), box, box + 4);
+            cand.mScores.insert(cand.mScores.end(), scores, scores + num_class);
+            cand.mId.push_back(id);
+            return;
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* read a word of the packet
+**/
+/**************************************************************************{{{*/
+template <class T>
+static inline T
+word(const uint8_t*& ptr)
+{
+    T val;
+    memcpy(&val, ptr, sizeof(val));
+    ptr += sizeof(val);
+    return val;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* cached SSD anchors {cx, cy, w, h}
+**/
+/**************************************************************************{{{*/
+static std::vector<float> gAnchors;
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* instance mask assembly
+* @par DESCRIPTION
+*   mask logit = coefficients . prototypes. coefficient j of the anchor a is
+*   mCoef[a*mStep + j*mStride], prototype j is the plane mProto[j*H*W..].
+**/
+/**************************************************************************{{{*/
+struct MaskSpec {
+    const float* mProto;
+    size_t       mChannels;         // number of the prototypes
+    size_t       mWidth;            // size of the prototype
+    size_t       mHeight;
+    const float* mCoef;
+    size_t       mStride;
+    size_t       mStep;
+    float        mRatioX;           // prototype / model input
+    float        mRatioY;
+    float        mLogit;            // threshold in the logit, sigmoid is not needed
+    bool         mBits;             // bit-packed in place of RLE
+};
+
+// sampling points of the bilinear interpolation: [lo, lo+1] and the weight of hi
+struct Taps {
+    std::vector<size_t> mLo, mHi;
+    std::vector<float>  mW;
+
+    Taps(int begin, int end, float scale, float offset, float ratio, size_t size) :
+        mLo(end - begin), mHi(end - begin), mW(end - begin)
+    {
+        for (int i = begin; i < end; i++) {
+            float p = ((i + 0.5f)*scale + offset)*ratio - 0.5f;
+            p = std::min(std::max(p, 0.0f), size - 1.0f);
+            size_t k = i - begin;
+            mLo[k] = static_cast<size_t>(p);
+            mHi[k] = std::min(mLo[k] + 1, size - 1);
+            mW[k]  = p - mLo[k];
+        }
+    }
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* mask of a detection
+* @par DESCRIPTION
+*   the logits are computed only over the prototype pixels under the box
+*   (the crop), upsampled by the bilinear interpolation to the pixels of
+*   the box in the reply coordinates, and compared with the threshold in
+*   the logit (sigmoid is monotonic).
+*   the box is in the model input coordinates, mapped to the original
+*   image if mapping is given.
+*
+* @retval json {"rect":[x, y, w, h], "rle":[0s, 1s, ..]} or
+*              {"rect":[x, y, w, h], "bits":base64}, row-major in the rect.
+**/
+/**************************************************************************{{{*/
+static json
+instance_mask(const MaskSpec& spec, unsigned int anchor, float x1, float y1, float x2, float y2, const BoxMapping* mapping)
+{
+    float scale_x = 1.0f, scale_y = 1.0f, offset_x = 0.0f, offset_y = 0.0f;
+    if (mapping) {
+        if (!map_box(*mapping, x1, y1, x2, y2)) {
+            return json();
+        }
+        scale_x  = mapping->scale_x;
+        scale_y  = mapping->scale_y;
+        offset_x = mapping->offset_x;
+        offset_y = mapping->offset_y;
+    }
+    else {
+        const float w = spec.mWidth/spec.mRatioX, h = spec.mHeight/spec.mRatioY;
+        x1 = std::min(std::max(x1, 0.0f), w);
+        y1 = std::min(std::max(y1, 0.0f), h);
+        x2 = std::min(std::max(x2, 0.0f), w);
+        y2 = std::min(std::max(y2, 0.0f), h);
+    }
+
+    // pixels whose center is in the box
+    const int left   = static_cast<int>(ceilf(x1 - 0.5f));
+    const int top    = static_cast<int>(ceilf(y1 - 0.5f));
+    const int width  = std::max(static_cast<int>(ceilf(x2 - 0.5f)) - left, 0);
+    const int height = std::max(static_cast<int>(ceilf(y2 - 0.5f)) - top, 0);
+
+    json res;
+    res["rect"] = { left, top, width, height };
+    std::vector<uint8_t> bits(static_cast<size_t>(width)*height);
+
+    if (!bits.empty()) {
+        Taps col(left, left + width, scale_x, offset_x, spec.mRatioX, spec.mWidth);
+        Taps row(top, top + height, scale_y, offset_y, spec.mRatioY, spec.mHeight);
+
+        // logits of the crop: a GEMM row of the coefficients and the prototypes
+        const size_t px0 = col.mLo.front(), rw = col.mHi.back() + 1 - px0;
+        const size_t py0 = row.mLo.front(), rh = row.mHi.back() + 1 - py0;
+        const size_t plane = spec.mWidth*spec.mHeight;
+        std::vector<float> logit(rw*rh, 0.0f);
+        for (size_t j = 0; j < spec.mChannels; j++) {
+            const float  a     = spec.mCoef[anchor*spec.mStep + j*spec.mStride];
+            const float* proto = spec.mProto + j*plane + py0*spec.mWidth + px0;
+            for (size_t y = 0; y < rh; y++) {
+                axpy_f32(&logit[y*rw], proto + y*spec.mWidth, a, rw);
+            }
+        }
+
+        // horizontal pass once per prototype row, then vertical pass and threshold
+        std::vector<float> hrow(rh*width);
+        for (size_t y = 0; y < rh; y++) {
+            const float* l = &logit[y*rw];
+            float*       h = &hrow[y*width];
+            for (int x = 0; x < width; x++) {
+                h[x] = l[col.mLo[x] - px0] + (l[col.mHi[x] - px0] - l[col.mLo[x] - px0])*col.mW[x];
+            }
+        }
+        for (int y = 0; y < height; y++) {
+            const float* lo = &hrow[(row.mLo[y] - py0)*width];
+            const float* hi = &hrow[(row.mHi[y] - py0)*width];
+            const float  w  = row.mW[y];
+            uint8_t*     b  = &bits[static_cast<size_t>(y)*width];
+            for (int x = 0; x < width; x++) {
+                b[x] = (lo[x] + (hi[x] - lo[x])*w) > spec.mLogit;
+            }
+        }
+    }
+
+    if (spec.mBits) {
+        std::vector<uint8_t> packed((bits.size() + 7)/8, 0);
+        for (size_t i = 0; i < bits.size(); i++) {
+            packed[i/8] |= bits[i] << (7 - i%8);
+        }
+        res["bits"] = base64(packed.data(), packed.size());
+    }
+    else {
+        std::vector<unsigned int> counts;
+        uint8_t      value = 0;
+        unsigned int run   = 0;
+        for (auto b : bits) {
+            if (b != value) {
+                counts.push_back(run);
+                value = b;
+                run   = 0;
+            }
+            run++;
+        }
+        counts.push_back(run);
+        res["rle"] = counts;
+    }
+
+    return res;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* masks of the detections
+* @par DESCRIPTION
+*   the detections are spread over the threads.
+*
+* @retval masks[class][n]
+**/
+/**************************************************************************{{{*/
+static void
+instance_masks(const MaskSpec& spec, const BoxArray& boxes, const std::vector<std::vector<Scored>>& result, const unsigned int* box_id,
+               const BoxMapping* mapping, std::vector<std::vector<json>>& masks)
+{
+    std::vector<std::pair<unsigned int, size_t>> dets;     // {class, n}
+    masks.resize(result.size());
+    for (unsigned int c = 0; c < result.size(); c++) {
+        masks[c].resize(result[c].size());
+        for (size_t n = 0; n < result[c].size(); n++) {
+            dets.emplace_back(c, n);
+        }
+    }
+
+    thread_pool().parallel_for(dets.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            unsigned int c = dets[i].first;
+            size_t       n = dets[i].second;
+            unsigned int b = result[c][n].second;
+            masks[c][n] = instance_mask(spec, box_id[b], boxes.mX1[b], boxes.mY1[b], boxes.mX2[b], boxes.mY2[b], mapping);
+        }
+    }, 1);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode the detection head and run NMS
+* @par DESCRIPTION
+*   read the output tensors in place, decode the boxes/scores of the head
+*   and feed the ones passing the score threshold to NMS.
+*
+*   head:
+*     0: YOLOv5  [.., N, 5+C] {cx, cy, w, h, obj, cls..}, score = obj*cls
+*     1: YOLOv8  [.., 4+C, N] {cx, cy, w, h, cls..} (transposed)
+*        {index} or, with flags 32, {index, proto index, mask threshold,
+*        in_width, in_height}: the mask coefficients follow the classes
+*        (YOLOv5/v8-seg) and the prototypes are [.., M, H, W].
+*        in_width/in_height: the model input (0: 4x the prototypes)
+*     2: YOLO raw grid, per level [1, A, H, W, 5+C] or [1, A*(5+C), H, W]
+*        level: {index, stride, A, anchor_w, anchor_h, ..}
+*     3: SSD     boxes [.., N, 4] deltas, scores [.., N, C] and the anchors
+*        {box index, score index, variance[4], background, num_anchor,
+*         {cx, cy, w, h}..}
+*        background: the class column never detected (-1: none).
+*        num_anchor 0 reuses the anchors sent before.
+*   flags:
+*     1: sigmoid on the class scores (YOLOv5/v8, SSD)
+*     2: SSD: softmax on the class scores
+*     4: SSD: deltas in {y, x, h, w} order
+*     8: grid: YOLOv3/v4 box formula (exp size) in place of YOLOv5's
+*    16: map the boxes to the original image by the letterbox of the last
+*        preprocessed image (clamped, empty boxes removed)
+*    32: YOLOv5/v8: add the instance mask to every detection (see
+*        instance_mask), in the model input or the original image with 16
+*    64: masks in bit-packed in place of RLE
+*
+* @retval json
+**/
+/**************************************************************************{{{*/
+std::string
+decode_detection(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int  head;
+        unsigned int  flags;
+        float         iou_threshold;
+        float         score_threshold;
+        float         sigma;
+        unsigned int  count;        // number of levels (YOLO grid)
+        uint8_t       data[1];      // head specific
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    const float thr = prms->score_threshold;
+    const bool  sig = (prms->flags & 1) != 0;
+
+    auto error = [](int status) {
+        json res;
+        res["status"] = status;
+        return res.dump();
+    };
+
+    Candidates cand;
+    unsigned int num_class = 0;
+    const uint8_t* ptr = prms->data;
+
+    const bool           with_mask = (prms->flags & 32) != 0;
+    MaskSpec             mask = {};
+    std::vector<int64_t> proto_shape;
+    std::vector<float>   proto_buf;
+    if (with_mask && prms->head > 1) {
+        return error(-3);
+    }
+
+    switch (prms->head) {
+    case 0: // YOLOv5
+    case 1: // YOLOv8
+        {
+        std::vector<int64_t> shape;
+        std::vector<float>   buf;
+        const float* x = output_f32(sys, word<uint32_t>(ptr), shape, buf);
+        if (x == nullptr || shape.size() < 2) {
+            return error(-1);
+        }
+        size_t rank = shape.size();
+        bool   v5   = (prms->head == 0);
+        size_t rows = v5 ? shape[rank-2] : shape[rank-1];
+        size_t cols = v5 ? shape[rank-1] : shape[rank-2];
+
+        size_t num_mask = 0;
+        if (with_mask) {
+            unsigned int proto_index = word<uint32_t>(ptr);
+            float        mask_thr    = word<float>(ptr);
+            unsigned int in_width    = word<uint32_t>(ptr);
+            unsigned int in_height   = word<uint32_t>(ptr);
+
+            const float* p = output_f32(sys, proto_index, proto_shape, proto_buf);
+            if (p == nullptr || proto_shape.size() < 3) {
+                return error(-1);
+            }
+            size_t prank = proto_shape.size();
+            num_mask = proto_shape[prank-3];
+            mask.mProto    = p;
+            mask.mChannels = num_mask;
+            mask.mWidth    = proto_shape[prank-1];
+            mask.mHeight   = proto_shape[prank-2];
+            mask.mStride   = v5 ? 1 : rows;
+            mask.mStep     = v5 ? cols : 1;
+            mask.mRatioX   = in_width  ? static_cast<float>(mask.mWidth)/in_width   : 0.25f;
+            mask.mRatioY   = in_height ? static_cast<float>(mask.mHeight)/in_height : 0.25f;
+            mask.mLogit    = logf(mask_thr/(1.0f - mask_thr));
+            mask.mBits     = (prms->flags & 64) != 0;
+            if (mask.mWidth == 0 || mask.mHeight == 0 || !(mask_thr > 0.0f && mask_thr < 1.0f)) {
+                return error(-3);
+            }
+        }
+        if (cols <= (v5 ? 5u : 4u) + num_mask) {
+            return error(-3);
+        }
+        num_class = static_cast<unsigned int>(cols - (v5 ? 5 : 4) - num_mask);
+        if (with_mask) {
+            mask.mCoef = v5 ? x + 5 + num_class : x + (4 + num_class)*rows;
+        }
+
+        decode_rows(rows, cand, [&](size_t row, Candidates& c) {
+            float box[4];
+            thread_local std::vector<float> score;
+            score.resize(num_class);
+            if (v5) {
+                const float* p = x + row*cols;
+                float obj = sig ? sigmoid(p[4]) : p[4];
+                if (obj <= thr) {
+                    return;
+                }
+                for (unsigned int k = 0; k < num_class; k++) {
+                    score[k] = obj*(sig ? sigmoid(p[5+k]) : p[5+k]);
+                }
+                memcpy(box, p, sizeof(box));
+            }
+            else {
+                for (unsigned int k = 0; k < num_class; k++) {
+                    float v = x[(4+k)*rows + row];
+                    score[k] = sig ? sigmoid(v) : v;
+                }
+                for (int k = 0; k < 4; k++) {
+                    box[k] = x[k*rows + row];
+                }
+            }
+            keep(c, static_cast<unsigned int>(row), box, score.data(), num_class, thr);
+        });
+        }
+        break;
+
+    case 2: // YOLO raw grid
+        {
+        unsigned int base = 0;
+        for (unsigned int level = 0; level < prms->count; level++) {
+            unsigned int index  = word<uint32_t>(ptr);
+            float        stride = word<float>(ptr);
+            unsigned int na     = word<uint32_t>(ptr);
+            std::vector<float> anchor(2*na);
+            for (auto& a : anchor) {
+                a = word<float>(ptr);
+            }
+
+            std::vector<int64_t> shape;
+            std::vector<float>   buf;
+            const float* x = output_f32(sys, index, shape, buf);
+            if (x == nullptr || na == 0) {
+                return error(-1);
+            }
+
+            // element (a, y, x, k) of [1, A, H, W, 5+C] or [1, A*(5+C), H, W]
+            size_t rank = shape.size(), H, W, K;
+            bool   last;
+            if (rank == 5) {
+                H = shape[2]; W = shape[3]; K = shape[4]; last = true;
+            }
+            else if (rank == 4 && shape[1] % na == 0) {
+                H = shape[2]; W = shape[3]; K = shape[1]/na; last = false;
+            }
+            else {
+                return error(-3);
+            }
+            if (K <= 5 || (num_class != 0 && num_class != K - 5)) {
+                return error(-3);
+            }
+            num_class = static_cast<unsigned int>(K - 5);
+
+            const bool v3 = (prms->flags & 8) != 0;
+            decode_rows(na*H*W, cand, [&](size_t row, Candidates& c) {
+                size_t a = row/(H*W), yx = row%(H*W);
+                auto at = [&](size_t k) {
+                    return last ? x[row*K + k] : x[(a*K + k)*H*W + yx];
+                };
+
+                float obj = sigmoid(at(4));
+                if (obj <= thr) {
+                    return;
+                }
+                float gx = static_cast<float>(yx%W), gy = static_cast<float>(yx/W);
+                float box[4];
+                if (v3) {
+                    box[0] = (sigmoid(at(0)) + gx)*stride;
+                    box[1] = (sigmoid(at(1)) + gy)*stride;
+                    box[2] = expf(at(2))*anchor[2*a];
+                    box[3] = expf(at(3))*anchor[2*a+1];
+                }
+                else {
+                    float sw = 2.0f*sigmoid(at(2)), sh = 2.0f*sigmoid(at(3));
+                    box[0] = (2.0f*sigmoid(at(0)) - 0.5f + gx)*stride;
+                    box[1] = (2.0f*sigmoid(at(1)) - 0.5f + gy)*stride;
+                    box[2] = sw*sw*anchor[2*a];
+                    box[3] = sh*sh*anchor[2*a+1];
+                }
+
+                thread_local std::vector<float> score;
+                score.resize(num_class);
+                for (unsigned int k = 0; k < num_class; k++) {
+                    score[k] = obj*sigmoid(at(5+k));
+                }
+                keep(c, static_cast<unsigned int>(base + row), box, score.data(), num_class, thr);
+            });
+            base += static_cast<unsigned int>(na*H*W);
+        }
+        }
+        break;
+
+    case 3: // SSD
+        {
+        unsigned int box_index   = word<uint32_t>(ptr);
+        unsigned int score_index = word<uint32_t>(ptr);
+        float var[4];
+        for (auto& v : var) {
+            v = word<float>(ptr);
+        }
+        int          background = word<int32_t>(ptr);
+        unsigned int num_anchor = word<uint32_t>(ptr);
+        if (num_anchor > 0) {
+            gAnchors.resize(4*num_anchor);
+            memcpy(gAnchors.data(), ptr, 4*num_anchor*sizeof(float));
+        }
+
+        std::vector<int64_t> bshape, sshape;
+        std::vector<float>   bbuf, sbuf;
+        const float* d = output_f32(sys, box_index, bshape, bbuf);
+        const float* s = output_f32(sys, score_index, sshape, sbuf);
+        if (d == nullptr || s == nullptr || bshape.size() < 2 || sshape.size() < 2) {
+            return error(-1);
+        }
+        size_t rows = bshape[bshape.size()-2];
+        if (bshape.back() != 4 || static_cast<size_t>(sshape[sshape.size()-2]) != rows || gAnchors.size() != 4*rows) {
+            return error(-3);
+        }
+        num_class = static_cast<unsigned int>(sshape.back());
+        if (background >= static_cast<int>(num_class)) {
+            return error(-3);
+        }
+
+        const bool yx      = (prms->flags & 4) != 0;
+        const bool softmax = (prms->flags & 2) != 0;
+        decode_rows(rows, cand, [&](size_t row, Candidates& c) {
+            const float* p = s + row*num_class;
+            thread_local std::vector<float> score;
+            score.assign(p, p + num_class);
+            if (softmax) {
+                float m = *std::max_element(score.begin(), score.end());
+                float sum = 0.0f;
+                for (auto& v : score) {
+                    v = expf(v - m);
+                    sum += v;
+                }
+                for (auto& v : score) {
+                    v /= sum;
+                }
+            }
+            else if (sig) {
+                for (auto& v : score) {
+                    v = sigmoid(v);
+                }
+            }
+            // the background takes part in the softmax only
+            if (background >= 0) {
+                score[background] = -INFINITY;
+            }
+
+            const float* a = &gAnchors[4*row];
+            const float* q = d + 4*row;
+            float dx = yx ? q[1] : q[0], dy = yx ? q[0] : q[1];
+            float dw = yx ? q[3] : q[2], dh = yx ? q[2] : q[3];
+            float box[4] = {
+                a[0] + dx*var[0]*a[2],
+                a[1] + dy*var[1]*a[3],
+                a[2]*expf(dw*var[2]),
+                a[3]*expf(dh*var[3])
+            };
+            keep(c, static_cast<unsigned int>(row), box, score.data(), num_class, thr);
+        });
+        }
+        break;
+
+    default:
+        return error(-3);
+    }
+
+    BoxMapping mapping;
+    if (prms->flags & 16) {
+        if (!sys.mLetterbox.mValid) {
+            return error(-3);
+        }
+        mapping = mapping_of(sys.mLetterbox);
+    }
+
+    const unsigned int num_boxes = static_cast<unsigned int>(cand.mId.size());
+    const BoxMapping*  map_ptr   = (prms->flags & 16) ? &mapping : nullptr;
+    BoxArray  box_array(num_boxes, 0, cand.mBoxes.data());
+    NmsParams nms = { prms->iou_threshold, thr, prms->sigma, 0, 0, false, NMS_AUTO, NMS_GREEDY };
+
+    std::vector<std::vector<Scored>> result;
+    nms_multi_class(box_array, num_boxes, num_class, cand.mScores.data(), nms, result);
+
+    std::vector<std::vector<json>> masks;
+    if (with_mask) {
+        instance_masks(mask, box_array, result, cand.mId.data(), map_ptr, masks);
+    }
+    std::string res = detections_json(box_array, result, cand.mId.data(), map_ptr, with_mask ? &masks : nullptr).dump();
+
+    sys.LAP_OUTPUT();
+
+    return res;
+}
+
 /*** nonmaxsuppression.cpp ************************************************}}}*/
@@ -96,6 +96,32 @@ Ort::Value& value)
     return size;
 }
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* convert onnx element type to dtype of TensorSpec
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static TensorSpec::DType
+to_dtype(ONNXTensorElementDataType type)
+{
+    switch (type) {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:   return TensorSpec::DTYPE_F32;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:   return TensorSpec::DTYPE_U8;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:    return TensorSpec::DTYPE_I8;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:  return TensorSpec::DTYPE_U16;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:   return TensorSpec::DTYPE_I16;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:   return TensorSpec::DTYPE_I32;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:   return TensorSpec::DTYPE_I64;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16: return TensorSpec::DTYPE_F16;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:  return TensorSpec::DTYPE_U32;
+    default:                                    return TensorSpec::DTYPE_NONE;
+    }
+}
+
 /***  Method Header  ******************************************************}}}*/
 /**
 * constructor
@@ -284,32 +310,38 @@ OnnxInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size)
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* set input tensor
+* execute inference
 * @par DESCRIPTION
 *
 *
 * @retval
 **/
 /**************************************************************************{{{*/
-int
-OnnxInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size, std::function<float(uint8_t)> conv)
+bool
+OnnxInterp::invoke()
 {
-//    if (size != mInput[index].GetStringTensorDataLength()/sizeof(float)) {
-//        return -2;
-//    }
-
-    float* dst = mInput[index].GetTensorMutableData<float>();
-    const uint8_t* src = data;
-    for (int i = 0; i < size; i++) {
-        *dst++ = conv(*src++);
-    }
+    mOutput = mSession.Run(Ort::RunOptions{nullptr}, mInputNames, mInput.data(), mInputCount, mOutputNames, mOutputCount);
+    return true;
+}
 
-    return size;
+/***  Module Header  ******************************************************}}}*/
+/**
+* get result tensor
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+std::string
+OnnxInterp::get_output_tensor(unsigned int index)
+{
+    return std::string(mOutput[index].GetTensorData<char>(), get_tensor_size(mOutput[index]));
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* execute inference
+* get raw buffer of input tensor
 * @par DESCRIPTION
 *
 *
@@ -317,25 +349,69 @@ OnnxInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size,
 **/
 /**************************************************************************{{{*/
 bool
-OnnxInterp::invoke()
+OnnxInterp::get_input_buffer(unsigned int index, TensorView& view)
 {
-    mOutput = mSession.Run(Ort::RunOptions{nullptr}, mInputNames, mInput.data(), mInputCount, mOutputNames, mOutputCount);
+    auto tensor_info = mInput[index].GetTensorTypeAndShapeInfo();
+
+    view.mData  = mInput[index].GetTensorMutableData<uint8_t>();
+    view.mBytes = get_tensor_size(mInput[index]);
+    view.mDType = to_dtype(tensor_info.GetElementType());
+    view.mShape = tensor_info.GetShape();
+
     return true;
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* get result tensor
+* get raw buffer of output tensor
 * @par DESCRIPTION
+*   valid until the next invoke.
 *
+* @retval
+**/
+/**************************************************************************{{{*/
+bool
+OnnxInterp::get_output_buffer(unsigned int index, TensorView& view)
+{
+    if (index >= mOutput.size()) {
+        return false;
+    }
+
+    auto tensor_info = mOutput[index].GetTensorTypeAndShapeInfo();
+
+    view.mData  = mOutput[index].GetTensorMutableData<uint8_t>();
+    view.mBytes = get_tensor_size(mOutput[index]);
+    view.mDType = to_dtype(tensor_info.GetElementType());
+    view.mShape = tensor_info.GetShape();
+
+    return true;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* resize input tensor
+* @par DESCRIPTION
+*   re-create the input tensor in the shape. the contents are undefined.
 *
 * @retval
 **/
 /**************************************************************************{{{*/
-std::string
-OnnxInterp::get_output_tensor(unsigned int index)
+bool
+OnnxInterp::resize_input_tensor(unsigned int index, const std::vector<int64_t>& shape)
 {
-    return std::string(mOutput[index].GetTensorData<char>(), get_tensor_size(mOutput[index]));
+    if (index >= mInputCount) {
+        return false;
+    }
+
+    auto tensor_info = mInput[index].GetTensorTypeAndShapeInfo();
+    if (tensor_info.GetShape() == shape) {
+        return true;
+    }
+
+    Ort::AllocatorWithDefaultOptions _ort_alloc;
+    mInput[index] = Ort::Value::CreateTensor(_ort_alloc, shape.data(), shape.size(), tensor_info.GetElementType());
+
+    return true;
 }
 
 /*** onnx_interp.cpp ******************************************************}}}*/
@@ -15,6 +15,17 @@
 *
 ***************************************************************************{{{*/
 std::string non_max_suppression_multi_class(SysInfo& sys, const void* args);
+std::string topk(SysInfo& sys, const void* args);
+std::string decode_detection(SysInfo& sys, const void* args);
+std::string non_max_suppression_batch(SysInfo& sys, const void* args);
+std::string segment_argmax(SysInfo& sys, const void* args);
+std::string keypoint_peaks(SysInfo& sys, const void* args);
+std::string ctc_decode(SysInfo& sys, const void* args);
+
+/**************************************************************************}}}**
+* helpers
+***************************************************************************{{{*/
+std::string base64(const uint8_t* data, size_t size);
 
 #define POST_PROCESS \
     non_max_suppression_multi_class
@@ -0,0 +1,617 @@
+/***  File Header  ************************************************************/
+/**
+* preprocess.cpp
+*
+* Tiny ML pre processing libraies: image
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 14:21:37 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <map>
+
+#include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "thread_pool.h"
+#include "preprocess.h"
+
+/*--- CONSTANT ---*/
+const int WBITS = 11;               // fraction bits of the bilinear weight
+const int WONE  = 1 << WBITS;
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* RGB image source
+* @par DESCRIPTION
+*   fetch a pixel from the interleaved u8 image (GRAY, RGB or RGBA).
+**/
+/**************************************************************************{{{*/
+struct RgbSource {
+    const uint8_t* mImage;
+    int            mWidth;
+    int            mHeight;
+    int            mChannels;
+    int            mStride;
+
+    inline void fetch(int x, int y, int rgb[3]) const {
+        const uint8_t* p = mImage + y*mStride + x*mChannels;
+        if (mChannels < 3) {
+            rgb[0] = rgb[1] = rgb[2] = p[0];
+        }
+        else {
+            rgb[0] = p[0]; rgb[1] = p[1]; rgb[2] = p[2];
+        }
+    }
+};
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* YUV image source
+* @par DESCRIPTION
+*   fetch a pixel from the camera frame (NV12, I420 or YUYV) converting it
+*   to RGB on the fly. limited range BT.601/BT.709 in 12bit fixed point.
+**/
+/**************************************************************************{{{*/
+struct YuvSource {
+    enum Format { NV12 = 0, I420 = 1, YUYV = 2 };
+
+    const uint8_t* mY;
+    const uint8_t* mU;
+    const uint8_t* mV;
+    int            mWidth;
+    int            mHeight;
+    int            mFormat;
+    int            mStrideY;
+    int            mStrideC;
+    int            mCoef[4];        // {V->R, U->G, V->G, U->B}
+
+    static const int CBITS = 12;
+
+    inline void fetch(int x, int y, int rgb[3]) const {
+        int Y, U, V;
+        switch (mFormat) {
+        case NV12:
+            {
+            const uint8_t* uv = mU + (y >> 1)*mStrideC + (x & ~1);
+            Y = mY[y*mStrideY + x];
+            U = uv[0];
+            V = uv[1];
+            }
+            break;
+        case I420:
+            Y = mY[y*mStrideY + x];
+            U = mU[(y >> 1)*mStrideC + (x >> 1)];
+            V = mV[(y >> 1)*mStrideC + (x >> 1)];
+            break;
+        default: // YUYV
+            {
+            const uint8_t* p = mY + y*mStrideY + 2*(x & ~1);
+            Y = p[(x & 1) ? 2 : 0];
+            U = p[1];
+            V = p[3];
+            }
+            break;
+        }
+
+        int luma = (Y - 16)*4768 + (1 << (CBITS - 1));      // 1.164
+        U -= 128;
+        V -= 128;
+        rgb[0] = clamp_u8((luma + mCoef[0]*V) >> CBITS);
+        rgb[1] = clamp_u8((luma - mCoef[1]*U - mCoef[2]*V) >> CBITS);
+        rgb[2] = clamp_u8((luma + mCoef[3]*U) >> CBITS);
+    }
+
+    static inline int clamp_u8(int x) {
+        return (x < 0) ? 0 : (x > 255) ? 255 : x;
+    }
+};
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* sampling table
+* @par DESCRIPTION
+*   source position and bilinear weight of every output pixel on an axis.
+**/
+/**************************************************************************{{{*/
+struct Sampling {
+    std::vector<int> mPos0;
+    std::vector<int> mPos1;
+    std::vector<int> mWeight;       // weight of mPos1 in [0, WONE]
+    std::vector<bool> mInside;      // false: padding area
+
+    Sampling(int dst_size, int src_size, float scale, float offset) :
+        mPos0(dst_size), mPos1(dst_size), mWeight(dst_size), mInside(dst_size)
+    {
+        for (int i = 0; i < dst_size; i++) {
+            float u = (i + 0.5f - offset)/scale;
+            mInside[i] = (u >= 0.0f && u < src_size);
+
+            float x = std::min(std::max(u - 0.5f, 0.0f), static_cast<float>(src_size - 1));
+            int   x0 = static_cast<int>(x);
+            mPos0[i]   = x0;
+            mPos1[i]   = std::min(x0 + 1, src_size - 1);
+            mWeight[i] = static_cast<int>(lrintf((x - x0)*WONE));
+        }
+    }
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* query the image input tensor
+* @par DESCRIPTION
+*   get the buffer and the width/height of the input tensor.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+image_tensor(TinyMLInterp* interp, unsigned int index, unsigned int layout, TensorView& view, int& W, int& H)
+{
+    if (!interp->get_input_buffer(index, view)) {
+        return -1;
+    }
+    if (view.mShape.size() < 3
+    || (view.mDType != TensorSpec::DTYPE_F32 && view.mDType != TensorSpec::DTYPE_U8)) {
+        return -3;
+    }
+
+    size_t rank = view.mShape.size();
+    int C;
+    if (layout == 0) {
+        C = static_cast<int>(view.mShape[rank-3]);
+        H = static_cast<int>(view.mShape[rank-2]);
+        W = static_cast<int>(view.mShape[rank-1]);
+    }
+    else {
+        H = static_cast<int>(view.mShape[rank-3]);
+        W = static_cast<int>(view.mShape[rank-2]);
+        C = static_cast<int>(view.mShape[rank-1]);
+    }
+
+    return (C == 3) ? 0 : -3;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* resize geometry
+* @par DESCRIPTION
+*   model_xy = image_xy*scale + offset
+*
+**/
+/**************************************************************************{{{*/
+static SysInfo::Letterbox
+resize_geometry(int W, int H, int width, int height, unsigned int resize)
+{
+    float sx = static_cast<float>(W)/width;
+    float sy = static_cast<float>(H)/height;
+    switch (resize) {
+    case 1:     // center crop
+        sx = sy = std::max(sx, sy);
+        break;
+    case 2:     // letterbox
+        sx = sy = std::min(sx, sy);
+        break;
+    default:    // stretch
+        break;
+    }
+
+    SysInfo::Letterbox lb;
+    lb.mValid   = true;
+    lb.mScaleX  = sx;
+    lb.mScaleY  = sy;
+    lb.mOffsetX = (W - width*sx)/2.0f;
+    lb.mOffsetY = (H - height*sy)/2.0f;
+    lb.mWidth   = width;
+    lb.mHeight  = height;
+
+    return lb;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* resample the image to the input tensor
+* @par DESCRIPTION
+*   bilinear resampling row by row on the thread pool. every row is formed
+*   in u8 RGB/BGR, then normalized into the tensor by the SIMD kernels.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+template <class Source>
+static int
+resample(TinyMLInterp* interp, unsigned int index, const Source& src, const PreprocessSpec& spec, SysInfo::Letterbox& lb)
+{
+    TensorView view;
+    int W, H;
+    int res = image_tensor(interp, index, spec.layout, view, W, H);
+    if (res < 0) {
+        return res;
+    }
+    if (src.mWidth <= 0 || src.mHeight <= 0) {
+        return -2;
+    }
+
+    lb = resize_geometry(W, H, src.mWidth, src.mHeight, spec.resize);
+    float sx = lb.mScaleX, sy = lb.mScaleY;
+    float ox = lb.mOffsetX, oy = lb.mOffsetY;
+
+    const Sampling xs(W, src.mWidth,  sx, ox);
+    const Sampling ys(H, src.mHeight, sy, oy);
+
+    // normalization: x*scale + bias
+    const int ch[3] = { spec.order ? 2 : 0, 1, spec.order ? 0 : 2 };
+    float scale[3], bias[3];
+    for (int c = 0; c < 3; c++) {
+        float sd = (spec.std[ch[c]] != 0.0f) ? spec.std[ch[c]] : 1.0f;
+        scale[c] = 1.0f/sd;
+        bias[c]  = -spec.mean[ch[c]]/sd;
+    }
+
+    const bool   is_float = (view.mDType == TensorSpec::DTYPE_F32);
+    const size_t plane    = static_cast<size_t>(H)*W;
+
+    thread_pool().parallel_for(H, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> row(3*W);
+        std::vector<uint8_t> chn(W);
+
+        for (size_t y = begin; y < end; y++) {
+            // form a row in u8
+            uint8_t* q = row.data();
+            for (int x = 0; x < W; x++, q += 3) {
+                if (!ys.mInside[y] || !xs.mInside[x]) {
+                    q[0] = spec.pad[ch[0]];
+                    q[1] = spec.pad[ch[1]];
+                    q[2] = spec.pad[ch[2]];
+                    continue;
+                }
+
+                int p00[3], p01[3], p10[3], p11[3];
+                src.fetch(xs.mPos0[x], ys.mPos0[y], p00);
+                src.fetch(xs.mPos1[x], ys.mPos0[y], p01);
+                src.fetch(xs.mPos0[x], ys.mPos1[y], p10);
+                src.fetch(xs.mPos1[x], ys.mPos1[y], p11);
+
+                int ax = xs.mWeight[x], ay = ys.mWeight[y];
+                for (int c = 0; c < 3; c++) {
+                    int r0 = p00[ch[c]]*(WONE - ax) + p01[ch[c]]*ax;
+                    int r1 = p10[ch[c]]*(WONE - ax) + p11[ch[c]]*ax;
+                    q[c] = static_cast<uint8_t>((r0*(WONE - ay) + r1*ay + (1 << (2*WBITS - 1))) >> (2*WBITS));
+                }
+            }
+
+            // put the row into the tensor
+            if (spec.layout == 0) {
+                for (int c = 0; c < 3; c++) {
+                    for (int x = 0; x < W; x++) {
+                        chn[x] = row[3*x + c];
+                    }
+                    size_t offset = c*plane + y*W;
+                    if (is_float) {
+                        u8_to_f32(reinterpret_cast<float*>(view.mData) + offset, chn.data(), W, scale[c], bias[c]);
+                    }
+                    else {
+                        memcpy(reinterpret_cast<uint8_t*>(view.mData) + offset, chn.data(), W);
+                    }
+                }
+            }
+            else {
+                size_t offset = 3*y*W;
+                if (is_float) {
+                    u8_to_f32(reinterpret_cast<float*>(view.mData) + offset, row.data(), 3*W, scale, bias, 3, 1);
+                }
+                else {
+                    memcpy(reinterpret_cast<uint8_t*>(view.mData) + offset, row.data(), 3*W);
+                }
+            }
+        }
+    }, 8);
+
+    return 0;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* preprocess RGB image
+* @par DESCRIPTION
+*   resize/crop/letterbox the interleaved u8 image and put it into the
+*   input tensor.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+int
+preprocess_rgb(TinyMLInterp* interp, unsigned int index,
+               const uint8_t* image, int width, int height, int channels, int stride,
+               const PreprocessSpec& spec, SysInfo::Letterbox& lb)
+{
+    if (channels != 1 && channels != 3 && channels != 4) {
+        return -3;
+    }
+
+    RgbSource src = { image, width, height, channels, (stride > 0) ? stride : width*channels };
+    return resample(interp, index, src, spec, lb);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set raw image to input tensor
+* @par DESCRIPTION
+*   input dtype 4: u8 HWC image of any size with the preprocessing spec.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+int
+set_input_image(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int   size;
+        unsigned int   index;
+        unsigned int   dtype;
+        unsigned int   width;
+        unsigned int   height;
+        unsigned int   channels;
+        PreprocessSpec spec;
+        uint8_t        data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    // in 64bit: the product of the header values must not wrap around
+    const uint64_t need = static_cast<uint64_t>(prms->width)*prms->height*prms->channels;
+    if (need == 0 || data_size < 0 || static_cast<uint64_t>(data_size) < need) {
+        return -2;
+    }
+
+    PreprocessSpec spec;
+    memcpy(&spec, &prms->spec, sizeof(spec));
+
+    int res = preprocess_rgb(interp, prms->index, prms->data, prms->width, prms->height, prms->channels, 0, spec, gSys.mLetterbox);
+
+    return (res < 0) ? res : prms_size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set camera frame to input tensor
+* @par DESCRIPTION
+*   input dtype 6: NV12/I420/YUYV frame with the preprocessing spec.
+*   the color conversion is fused into the resampling, so the frame is
+*   read just once.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+int
+set_input_yuv(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int   size;
+        unsigned int   index;
+        unsigned int   dtype;
+        unsigned int   format;      // 0:NV12, 1:I420, 2:YUYV
+        unsigned int   matrix;      // 0:BT.601, 1:BT.709
+        unsigned int   width;
+        unsigned int   height;
+        unsigned int   stride;      // bytes per row of Y (YUYV: packed) plane, 0:tight
+        PreprocessSpec spec;
+        uint8_t        data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    const int width  = prms->width;
+    const int height = prms->height;
+    const int half_h = (height + 1)/2;
+    const int half_w = (width + 1)/2;
+    if (width <= 0 || height <= 0) {
+        return -2;
+    }
+
+    YuvSource src;
+    src.mWidth  = width;
+    src.mHeight = height;
+    src.mFormat = prms->format;
+
+    size_t need;
+    switch (prms->format) {
+    case YuvSource::NV12:
+        // a chroma row is the interleaved UV pairs: 2*half_w bytes
+        src.mStrideY = (prms->stride > 0) ? prms->stride : width;
+        src.mStrideC = (prms->stride > 0) ? prms->stride : 2*half_w;
+        if (src.mStrideY < width || src.mStrideC < 2*half_w) {
+            return -2;
+        }
+        src.mY = prms->data;
+        src.mU = src.mY + static_cast<size_t>(src.mStrideY)*height;
+        src.mV = src.mU + 1;
+        need = static_cast<size_t>(src.mStrideY)*height + static_cast<size_t>(src.mStrideC)*half_h;
+        break;
+    case YuvSource::I420:
+        src.mStrideY = (prms->stride > 0) ? prms->stride : width;
+        src.mStrideC = (src.mStrideY + 1)/2;
+        if (src.mStrideY < width) {
+            return -2;
+        }
+        src.mY = prms->data;
+        src.mU = src.mY + static_cast<size_t>(src.mStrideY)*height;
+        src.mV = src.mU + static_cast<size_t>(src.mStrideC)*half_h;
+        need = static_cast<size_t>(src.mStrideY)*height + 2*static_cast<size_t>(src.mStrideC)*half_h;
+        break;
+    case YuvSource::YUYV:
+        if (width % 2 != 0) {
+            return -2;
+        }
+        src.mStrideY = (prms->stride > 0) ? prms->stride : 2*width;
+        src.mStrideC = 0;
+        if (src.mStrideY < 2*width) {
+            return -2;
+        }
+        src.mY = src.mU = src.mV = prms->data;
+        need = static_cast<size_t>(src.mStrideY)*height;
+        break;
+    default:
+        return -3;
+    }
+    if (data_size < 0 || static_cast<size_t>(data_size) < need) {
+        return -2;
+    }
+
+    static const int coef[2][4] = {
+        { 6537, 1605, 3330, 8261 },     // BT.601: 1.596, 0.392, 0.813, 2.017
+        { 7343,  873, 2183, 8652 },     // BT.709: 1.793, 0.213, 0.533, 2.112
+    };
+    memcpy(src.mCoef, coef[prms->matrix ? 1 : 0], sizeof(src.mCoef));
+
+    PreprocessSpec spec;
+    memcpy(&spec, &prms->spec, sizeof(spec));
+
+    int res = resample(interp, prms->index, src, spec, gSys.mLetterbox);
+
+    return (res < 0) ? res : prms_size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* pending decode jobs
+* @par DESCRIPTION
+*   encoded images are decoded on the thread pool while the next command
+*   arrives. the jobs are joined before the input tensor is touched again.
+**/
+/**************************************************************************{{{*/
+struct DecodeResult {
+    int                mStatus;
+    SysInfo::Letterbox mLetterbox;
+};
+
+static std::map<unsigned int, std::future<DecodeResult>> gPending;
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* decode and preprocess the encoded image
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static DecodeResult
+decode_and_preprocess(TinyMLInterp* interp, unsigned int index, const std::vector<uint8_t>& data, const PreprocessSpec& spec)
+{
+    DecodeResult result;
+
+    TensorView view;
+    int W, H;
+    result.mStatus = image_tensor(interp, index, spec.layout, view, W, H);
+    if (result.mStatus < 0) {
+        return result;
+    }
+
+    // let the decoder reduce the image as far as it stays larger than the resized one.
+    DecodedImage image;
+    result.mStatus = decode_image(data.data(), data.size(), [W, H, &spec](int width, int height) {
+        SysInfo::Letterbox lb = resize_geometry(W, H, width, height, spec.resize);
+        return 1.0f/((spec.resize == 0) ? std::max(lb.mScaleX, lb.mScaleY) : lb.mScaleX);
+    }, image);
+    if (result.mStatus < 0) {
+        return result;
+    }
+
+    result.mStatus = preprocess_rgb(interp, index, image.mPixel.data(), image.mWidth, image.mHeight, image.mChannels, 0, spec, result.mLetterbox);
+
+    // geometry on the original image
+    result.mLetterbox.mScaleX *= static_cast<float>(image.mWidth)/image.mOrgWidth;
+    result.mLetterbox.mScaleY *= static_cast<float>(image.mHeight)/image.mOrgHeight;
+    result.mLetterbox.mWidth   = image.mOrgWidth;
+    result.mLetterbox.mHeight  = image.mOrgHeight;
+
+    return result;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* wait for the decode jobs
+* @par DESCRIPTION
+*   join the pending job of "index" (or all jobs if index < 0).
+*
+* @retval true  all jobs succeeded
+* @retval false some job failed
+**/
+/**************************************************************************{{{*/
+bool
+wait_input_image(int index)
+{
+    bool ok = true;
+
+    for (auto it = gPending.begin(); it != gPending.end();) {
+        if (index >= 0 && it->first != static_cast<unsigned int>(index)) {
+            it++;
+            continue;
+        }
+
+        DecodeResult result = it->second.get();
+        if (result.mStatus < 0) {
+            ok = false;
+        }
+        else {
+            gSys.mLetterbox = result.mLetterbox;
+        }
+        it = gPending.erase(it);
+    }
+
+    return ok;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set encoded image to input tensor
+* @par DESCRIPTION
+*   input dtype 5: JPEG/PNG image with the preprocessing spec.
+*   decoding runs on the thread pool and is joined by wait_input_image().
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+int
+set_input_encoded_image(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int   size;
+        unsigned int   index;
+        unsigned int   dtype;
+        PreprocessSpec spec;
+        uint8_t        data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    if (data_size <= 0) {
+        return -2;
+    }
+
+    unsigned int index = prms->index;
+    wait_input_image(index);
+
+    PreprocessSpec spec;
+    memcpy(&spec, &prms->spec, sizeof(spec));
+    std::vector<uint8_t> data(prms->data, prms->data + data_size);
+
+    gPending[index] = thread_pool().submit([interp, index, spec, data]() {
+        return decode_and_preprocess(interp, index, data, spec);
+    });
+
+    return prms_size;
+}
+
+/*** preprocess.cpp *******************************************************}}}*/
@@ -0,0 +1,53 @@
+/***  File Header  ************************************************************/
+/**
+* preprocess.h
+*
+* Tiny ML pre processing libraies: image
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 14:21:37 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _PREPROCESS_H
+#define _PREPROCESS_H
+
+/**************************************************************************}}}**
+* parameters of the image preprocessing
+***************************************************************************{{{*/
+PACK(
+struct PreprocessSpec {
+    unsigned int resize;        // 0:stretch, 1:center crop, 2:letterbox
+    unsigned int order;         // 0:RGB, 1:BGR
+    unsigned int layout;        // 0:NCHW, 1:NHWC
+    uint8_t      pad[4];        // padding color of letterbox {r, g, b, -}
+    float        mean[3];       // normalization: (x - mean)/std
+    float        std[3];
+});
+
+/**************************************************************************}}}**
+* decoded image
+***************************************************************************{{{*/
+struct DecodedImage {
+    int                  mOrgWidth;     // size of the encoded image
+    int                  mOrgHeight;
+    int                  mWidth;        // size of the decoded (scaled) image
+    int                  mHeight;
+    int                  mChannels;
+    std::vector<uint8_t> mPixel;
+};
+
+int decode_image(const uint8_t* data, size_t size, std::function<float(int, int)> reduce, DecodedImage& image);
+
+/**************************************************************************}}}**
+*
+***************************************************************************{{{*/
+int set_input_image(TinyMLInterp* interp, const void* args);
+int set_input_encoded_image(TinyMLInterp* interp, const void* args);
+int set_input_yuv(TinyMLInterp* interp, const void* args);
+bool wait_input_image(int index=-1);
+
+int preprocess_rgb(TinyMLInterp* interp, unsigned int index,
+                   const uint8_t* image, int width, int height, int channels, int stride,
+                   const PreprocessSpec& spec, SysInfo::Letterbox& lb);
+
+#endif /* _PREPROCESS_H */
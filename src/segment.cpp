@@ -0,0 +1,298 @@
+/***  File Header  ************************************************************/
+/**
+* segment.cpp
+*
+* Tiny ML post processing libraies: semantic segmentation
+* @author      Shozo Fukuda
+* @date create Tue Oct 20 15:02:47 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "thread_pool.h"
+#include "postprocess.h"
+
+/*--- CONSTANT ---*/
+const size_t BLOCK = 1024;      // pixels processed at once over all the channels
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* base64 encoding
+**/
+/**************************************************************************{{{*/
+std::string
+base64(const uint8_t* data, size_t size)
+{
+    static const char TBL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string res;
+    res.reserve((size + 2)/3*4);
+    size_t i = 0;
+    for (; i + 2 < size; i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+        res += TBL[(v >> 18) & 63];
+        res += TBL[(v >> 12) & 63];
+        res += TBL[(v >>  6) & 63];
+        res += TBL[v & 63];
+    }
+    if (i < size) {
+        uint32_t v = (data[i] << 16) | ((i + 1 < size) ? (data[i+1] << 8) : 0);
+        res += TBL[(v >> 18) & 63];
+        res += TBL[(v >> 12) & 63];
+        res += (i + 1 < size) ? TBL[(v >> 6) & 63] : '=';
+        res += '=';
+    }
+    return res;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* argmax over the channels of planar logits
+* @par DESCRIPTION
+*   x[c*plane + p]. a block of pixels is kept in the cache over all the
+*   channels, and every channel is folded in by the SIMD argmax step.
+*   ties are taken by the lower channel.
+*   conf: softmax probability of the label (optional)
+*
+**/
+/**************************************************************************{{{*/
+template <class Loader>
+static void
+argmax_planar(Loader load, size_t channels, size_t begin, size_t end, uint16_t* label, float* conf)
+{
+    float    buf[BLOCK];
+    float    best[BLOCK];
+    uint32_t idx[BLOCK];
+
+    for (size_t base = begin; base < end; base += BLOCK) {
+        size_t len = std::min(BLOCK, end - base);
+
+        memcpy(best, load(0, base, len, buf), len*sizeof(float));
+        std::fill(idx, idx + len, 0);
+        for (size_t c = 1; c < channels; c++) {
+            argmax_f32(best, idx, load(c, base, len, buf), static_cast<uint32_t>(c), len);
+        }
+        std::copy(idx, idx + len, label + base);
+
+        if (conf) {
+            float* sum = conf + base;
+            std::fill(sum, sum + len, 0.0f);
+            for (size_t c = 0; c < channels; c++) {
+                const float* x = load(c, base, len, buf);
+                for (size_t i = 0; i < len; i++) {
+                    sum[i] += expf(x[i] - best[i]);
+                }
+            }
+            for (size_t i = 0; i < len; i++) {
+                sum[i] = 1.0f/sum[i];
+            }
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* argmax over the channels of interleaved logits
+* @par DESCRIPTION
+*   x[p*channels + c].
+*
+**/
+/**************************************************************************{{{*/
+static void
+argmax_interleaved(const float* x, size_t channels, size_t begin, size_t end, uint16_t* label, float* conf)
+{
+    for (size_t p = begin; p < end; p++) {
+        const float* v = x + p*channels;
+        size_t id = std::max_element(v, v + channels) - v;
+        label[p] = static_cast<uint16_t>(id);
+
+        if (conf) {
+            float sum = 0.0f;
+            for (size_t c = 0; c < channels; c++) {
+                sum += expf(v[c] - v[id]);
+            }
+            conf[p] = 1.0f/sum;
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* per-pixel argmax of the segmentation logits
+* @par DESCRIPTION
+*   take the channel argmax of the output tensor [.., C, H, W] (or
+*   [.., H, W, C] with flags 1) and reply the label mask, resized by the
+*   nearest neighbor if requested. only the first image of a batch.
+*   flags:
+*     1: channels last (NHWC)
+*     2: add the confidence (softmax probability of the label) as u8 0..255
+*     4: map the mask to the original image by the letterbox of the last
+*        preprocessed image. in_width/in_height: the model input covered by
+*        the mask (0: the size of the mask)
+*   width/height: size of the mask to reply (0: as it is, or the original
+*   image with flags 4)
+*
+* @retval json {"status":0, "width":W, "height":H, "dtype":"u8"|"u16",
+*               "mask":base64, "confidence":base64}
+**/
+/**************************************************************************{{{*/
+std::string
+segment_argmax(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int index;
+        unsigned int flags;
+        unsigned int width;
+        unsigned int height;
+        unsigned int in_width;
+        unsigned int in_height;
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    auto error = [](int status) {
+        json res;
+        res["status"] = status;
+        return res.dump();
+    };
+
+    TensorView view;
+    if (prms->index >= sys.mInterp->OutputCount() || !sys.mInterp->get_output_buffer(prms->index, view)) {
+        return error(-1);
+    }
+    if ((view.mDType != TensorSpec::DTYPE_F32 && view.mDType != TensorSpec::DTYPE_F16)
+    ||  view.mShape.size() < 3) {
+        return error(-3);
+    }
+    if ((prms->flags & 4) && !sys.mLetterbox.mValid) {
+        return error(-3);
+    }
+
+    const size_t rank   = view.mShape.size();
+    const bool   nhwc   = (prms->flags & 1) != 0;
+    const size_t chs    = static_cast<size_t>(nhwc ? view.mShape[rank-1] : view.mShape[rank-3]);
+    const size_t mask_h = static_cast<size_t>(nhwc ? view.mShape[rank-3] : view.mShape[rank-2]);
+    const size_t mask_w = static_cast<size_t>(nhwc ? view.mShape[rank-2] : view.mShape[rank-1]);
+    const size_t plane  = mask_h*mask_w;
+    if (chs == 0 || chs > 65536 || plane == 0) {
+        return error(-3);
+    }
+
+    const bool is_f16    = (view.mDType == TensorSpec::DTYPE_F16);
+    const bool with_conf = (prms->flags & 2) != 0;
+
+    // argmax at the resolution of the output tensor
+    std::vector<uint16_t> label(plane);
+    std::vector<float>    conf(with_conf ? plane : 0);
+    float* conf_ptr = with_conf ? conf.data() : nullptr;
+
+    if (nhwc) {
+        std::vector<float> wide(is_f16 ? plane*chs : 0);
+        if (is_f16) {
+            f16_to_f32(wide.data(), reinterpret_cast<const uint8_t*>(view.mData), plane*chs);
+        }
+        const float* x = is_f16 ? wide.data() : reinterpret_cast<const float*>(view.mData);
+        thread_pool().parallel_for(plane, [&](size_t begin, size_t end) {
+            argmax_interleaved(x, chs, begin, end, label.data(), conf_ptr);
+        }, BLOCK);
+    }
+    else if (is_f16) {
+        const uint8_t* x = reinterpret_cast<const uint8_t*>(view.mData);
+        thread_pool().parallel_for(plane, [&](size_t begin, size_t end) {
+            auto load = [&](size_t c, size_t base, size_t len, float* buf) -> const float* {
+                f16_to_f32(buf, x + 2*(c*plane + base), len);
+                return buf;
+            };
+            argmax_planar(load, chs, begin, end, label.data(), conf_ptr);
+        }, BLOCK);
+    }
+    else {
+        const float* x = reinterpret_cast<const float*>(view.mData);
+        thread_pool().parallel_for(plane, [&](size_t begin, size_t end) {
+            auto load = [&](size_t c, size_t base, size_t, float*) -> const float* {
+                return x + c*plane + base;
+            };
+            argmax_planar(load, chs, begin, end, label.data(), conf_ptr);
+        }, BLOCK);
+    }
+
+    // nearest neighbor sampling: mask_xy = out_xy*scale + offset
+    size_t out_w = mask_w, out_h = mask_h;
+    double scale_x = 1.0, scale_y = 1.0, offset_x = 0.0, offset_y = 0.0;
+    if (prms->flags & 4) {
+        const auto& lb = sys.mLetterbox;
+        double ratio_x = prms->in_width  ? static_cast<double>(mask_w)/prms->in_width  : 1.0;
+        double ratio_y = prms->in_height ? static_cast<double>(mask_h)/prms->in_height : 1.0;
+        out_w    = prms->width  ? prms->width  : lb.mWidth;
+        out_h    = prms->height ? prms->height : lb.mHeight;
+        scale_x  = ratio_x*lb.mScaleX*lb.mWidth/out_w;
+        scale_y  = ratio_y*lb.mScaleY*lb.mHeight/out_h;
+        offset_x = ratio_x*lb.mOffsetX;
+        offset_y = ratio_y*lb.mOffsetY;
+    }
+    else if (prms->width && prms->height) {
+        out_w   = prms->width;
+        out_h   = prms->height;
+        scale_x = static_cast<double>(mask_w)/out_w;
+        scale_y = static_cast<double>(mask_h)/out_h;
+    }
+    if (out_w == 0 || out_h == 0) {
+        return error(-3);
+    }
+
+    std::vector<size_t> col(out_w), row(out_h);
+    for (size_t x = 0; x < out_w; x++) {
+        double v = (x + 0.5)*scale_x + offset_x;
+        col[x] = static_cast<size_t>(std::min(std::max(v, 0.0), mask_w - 1.0));
+    }
+    for (size_t y = 0; y < out_h; y++) {
+        double v = (y + 0.5)*scale_y + offset_y;
+        row[y] = static_cast<size_t>(std::min(std::max(v, 0.0), mask_h - 1.0))*mask_w;
+    }
+
+    const bool   wide_label = (chs > 256);
+    const size_t label_size = wide_label ? 2 : 1;
+    std::vector<uint8_t> mask(out_w*out_h*label_size);
+    std::vector<uint8_t> prob(with_conf ? out_w*out_h : 0);
+    thread_pool().parallel_for(out_h, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            for (size_t x = 0; x < out_w; x++) {
+                size_t src = row[y] + col[x];
+                size_t dst = y*out_w + x;
+                if (wide_label) {
+                    mask[2*dst]   = static_cast<uint8_t>(label[src]);
+                    mask[2*dst+1] = static_cast<uint8_t>(label[src] >> 8);
+                }
+                else {
+                    mask[dst] = static_cast<uint8_t>(label[src]);
+                }
+                if (with_conf) {
+                    prob[dst] = static_cast<uint8_t>(conf[src]*255.0f + 0.5f);
+                }
+            }
+        }
+    }, 16);
+
+    json res;
+    res["status"] = 0;
+    res["width"]  = out_w;
+    res["height"] = out_h;
+    res["dtype"]  = wide_label ? "u16" : "u8";
+    res["mask"]   = base64(mask.data(), mask.size());
+    if (with_conf) {
+        res["confidence"] = base64(prob.data(), prob.size());
+    }
+
+    sys.LAP_OUTPUT();
+
+    return res.dump();
+}
+
+/*** segment.cpp **********************************************************}}}*/
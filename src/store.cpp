@@ -0,0 +1,225 @@
+/***  File Header  ************************************************************/
+/**
+* store.cpp
+*
+* Tiny ML named tensors kept in the process
+* @author      Shozo Fukuda
+* @date create Sat Oct 24 11:07:36 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <string.h>
+#include <list>
+#include <unordered_map>
+
+#include "tiny_ml.h"
+#include "store.h"
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* tensor store
+* @par DESCRIPTION
+*   the named binaries in the order of use (the front: the most recent).
+*   the least recently used ones are evicted over the capacity.
+*
+**/
+/**************************************************************************{{{*/
+class TensorStore {
+    typedef std::pair<std::string, std::vector<uint8_t>> Item;
+
+//LIFECYCLE:
+public:
+    TensorStore() : mBytes(0) {}
+
+//ACTION:
+public:
+    // put the binary under the name, and reply the evicted names
+    std::vector<std::string> put(const std::string& name, const uint8_t* data, size_t size, size_t limit) {
+        remove(name);
+
+        std::vector<std::string> evicted;
+        while (!mItems.empty() && mBytes + size > limit) {
+            evicted.push_back(mItems.back().first);
+            remove(mItems.back().first);
+        }
+
+        mItems.emplace_front(name, std::vector<uint8_t>(data, data + size));
+        mIndex[name] = mItems.begin();
+        mBytes += size;
+        return evicted;
+    }
+
+    // get the binary and mark it as the most recent
+    const std::vector<uint8_t>* get(const std::string& name) {
+        auto found = mIndex.find(name);
+        if (found == mIndex.end()) {
+            return nullptr;
+        }
+        mItems.splice(mItems.begin(), mItems, found->second);
+        return &found->second->second;
+    }
+
+    bool remove(const std::string& name) {
+        auto found = mIndex.find(name);
+        if (found == mIndex.end()) {
+            return false;
+        }
+        mBytes -= found->second->second.size();
+        mItems.erase(found->second);
+        mIndex.erase(found);
+        return true;
+    }
+
+//INQUIRY:
+public:
+    size_t Bytes() { return mBytes;        }
+    size_t Count() { return mItems.size(); }
+
+//ATTRIBUTE:
+protected:
+    std::list<Item> mItems;
+    std::unordered_map<std::string, std::list<Item>::iterator> mIndex;
+    size_t          mBytes;
+};
+
+static TensorStore gStore;
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* upload a tensor under the name
+* @par DESCRIPTION
+*   keep the binary in the process to be bound to the input tensors later
+*   without sending it again. the least recently used tensors are evicted
+*   over the capacity (--store).
+*   flags:
+*     1: remove the tensor of the name
+*   data: name[name_size], binary[size]
+*
+* @retval json {"status":0, "bytes":bytes in use, "evicted":[names..]}
+**/
+/**************************************************************************{{{*/
+std::string
+store_tensor(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int flags;
+        unsigned int size;
+        unsigned int name_size;
+        char         data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    json res;
+
+    std::string name(prms->data, prms->name_size);
+    if (prms->flags & 1) {
+        res["status"] = gStore.remove(name) ? 0 : -1;
+    }
+    else if (prms->size > sys.mStoreLimit) {
+        res["status"] = -2;
+    }
+    else {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(prms->data) + prms->name_size;
+        res["status"]  = 0;
+        res["evicted"] = gStore.put(name, data, prms->size, sys.mStoreLimit);
+    }
+    res["bytes"] = gStore.Bytes();
+
+    return res.dump();
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set the stored tensor to the input tensor
+* @par DESCRIPTION
+*   the size of the stored tensor must be that of the input tensor.
+*   unknown (or evicted) name is -1.
+*
+* @retval size of the args or error code
+**/
+/**************************************************************************{{{*/
+int
+set_input_stored(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        unsigned int index;
+        unsigned int dtype;
+        unsigned int name_size;
+        char         name[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+
+    const std::vector<uint8_t>* blob = gStore.get(std::string(prms->name, prms->name_size));
+    if (blob == nullptr) {
+        return -1;
+    }
+
+    TensorView view;
+    if (!interp->get_input_buffer(prms->index, view)) {
+        return -1;
+    }
+    if (view.mBytes != blob->size()) {
+        return -2;
+    }
+    memcpy(view.mData, blob->data(), blob->size());
+
+    return prms_size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* overwrite a byte range of the input tensor
+* @par DESCRIPTION
+*   only the changed region is sent, and the rest of the tensor keeps what
+*   is set before.
+*
+* @retval size of the args or error code
+**/
+/**************************************************************************{{{*/
+int
+set_input_patch(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        unsigned int index;
+        unsigned int dtype;
+        unsigned int offset;
+        uint8_t      data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    TensorView view;
+    if (!interp->get_input_buffer(prms->index, view)) {
+        return -1;
+    }
+    if (data_size < 0 || prms->offset > view.mBytes || static_cast<size_t>(data_size) > view.mBytes - prms->offset) {
+        return -2;
+    }
+    memcpy(reinterpret_cast<uint8_t*>(view.mData) + prms->offset, prms->data, data_size);
+
+    return prms_size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* usage of the tensor store
+**/
+/**************************************************************************{{{*/
+void
+store_info(SysInfo& sys, json& res)
+{
+    res["store"]["bytes"] = gStore.Bytes();
+    res["store"]["count"] = gStore.Count();
+    res["store"]["limit"] = sys.mStoreLimit;
+}
+
+/*** store.cpp ************************************************************}}}*/
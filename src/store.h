@@ -0,0 +1,23 @@
+/***  File Header  ************************************************************/
+/**
+* store.h
+*
+* Tiny ML named tensors kept in the process
+* @author      Shozo Fukuda
+* @date create Sat Oct 24 11:07:36 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _STORE_H
+#define _STORE_H
+
+/**************************************************************************}}}**
+*
+***************************************************************************{{{*/
+int  set_input_stored(TinyMLInterp* interp, const void* args);
+int  set_input_patch(TinyMLInterp* interp, const void* args);
+void store_info(SysInfo& sys, json& res);
+
+std::string store_tensor(SysInfo& sys, const void* args);
+
+#endif /* _STORE_H */
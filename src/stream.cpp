@@ -0,0 +1,207 @@
+/***  File Header  ************************************************************/
+/**
+* stream.cpp
+*
+* Tiny ML streaming inputs and recurrent states
+* @author      Shozo Fukuda
+* @date create Fri Oct 23 10:42:18 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+#include "tiny_ml.h"
+#include "generate.h"
+#include "stream.h"
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* sliding window of an input tensor
+**/
+/**************************************************************************{{{*/
+struct InputRing {
+    std::vector<uint8_t> mBuf;      // the window: bytes of the input tensor
+    size_t               mHead;     // the oldest byte, where the next is written
+};
+
+static std::map<unsigned int, InputRing> gRing;
+
+// recurrent states: {output, input} copied after every invoke
+static std::vector<std::pair<unsigned int, unsigned int>> gRoute;
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* append the samples to the sliding window of the input tensor
+* @par DESCRIPTION
+*   the window is the whole input tensor, sliding along its outermost axis
+*   longer than 1 (e.g. T of [1, T, F] or [1, T]). only the new samples (a
+*   hop of whole steps, e.g. F values each) in the dtype of the tensor are
+*   sent every step, and the window is put into the tensor at invoke. the
+*   window starts with zeros.
+*   flags:
+*     1: reset the window before appending
+*
+* @retval size of the args or error code
+**/
+/**************************************************************************{{{*/
+int
+set_input_stream(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        unsigned int index;
+        unsigned int dtype;
+        unsigned int flags;
+        uint8_t      data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    TensorView view;
+    if (!interp->get_input_buffer(prms->index, view)) {
+        return -1;
+    }
+    if (dtype_size(view.mDType) == 0 || view.mBytes == 0) {
+        return -3;
+    }
+
+    // bytes of one step along the sliding axis
+    auto axis = std::find_if(view.mShape.begin(), view.mShape.end(), [](int64_t n) { return n > 1; });
+    const size_t step = (axis != view.mShape.end()) ? view.mBytes/static_cast<size_t>(*axis) : view.mBytes;
+    if (data_size < 0 || data_size % step != 0) {
+        return -2;
+    }
+
+    InputRing& ring = gRing[prms->index];
+    const size_t window = view.mBytes;
+    if ((prms->flags & 1) || ring.mBuf.size() != window) {
+        ring.mBuf.assign(window, 0);
+        ring.mHead = 0;
+    }
+
+    const uint8_t* src = prms->data;
+    size_t         len = static_cast<size_t>(data_size);
+    if (len >= window) {
+        // only the newest window survives
+        memcpy(ring.mBuf.data(), src + (len - window), window);
+        ring.mHead = 0;
+    }
+    else {
+        size_t first = std::min(len, window - ring.mHead);
+        memcpy(&ring.mBuf[ring.mHead], src, first);
+        memcpy(&ring.mBuf[0], src + first, len - first);
+        ring.mHead = (ring.mHead + len) % window;
+    }
+
+    return prms_size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* stop the sliding window of the input tensor
+* @par DESCRIPTION
+*   the tensor set in the other ways is not overwritten at invoke.
+*
+**/
+/**************************************************************************{{{*/
+void
+close_input_stream(unsigned int index)
+{
+    gRing.erase(index);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* execute inference with the streaming inputs and the recurrent states
+* @par DESCRIPTION
+*   put every window into its input tensor straight from the ring (the
+*   oldest part, then the newest), invoke, and copy the state outputs into
+*   their inputs for the next step.
+*
+* @retval true on success
+**/
+/**************************************************************************{{{*/
+bool
+invoke_stream(TinyMLInterp* interp)
+{
+    for (const auto& item : gRing) {
+        const InputRing& ring = item.second;
+
+        TensorView view;
+        if (!interp->get_input_buffer(item.first, view) || view.mBytes != ring.mBuf.size()) {
+            return false;
+        }
+        uint8_t* dst   = reinterpret_cast<uint8_t*>(view.mData);
+        size_t   older = ring.mBuf.size() - ring.mHead;
+        memcpy(dst, &ring.mBuf[ring.mHead], older);
+        memcpy(dst + older, &ring.mBuf[0], ring.mHead);
+    }
+
+    if (!interp->invoke()) {
+        return false;
+    }
+
+    return feed_back(interp, gRoute) == 0;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* route the recurrent state outputs back to the inputs
+* @par DESCRIPTION
+*   after every invoke, the output tensor is copied into the input tensor
+*   as the state of the next step (e.g. the hidden/cell states of RNNs and
+*   the caches of streaming models). the routes replace the previous ones,
+*   and count 0 removes them.
+*   flags:
+*     1: zero the state inputs now (start of a new stream)
+*   data: {output, input}[count]
+*
+* @retval json {"status":0}
+**/
+/**************************************************************************{{{*/
+std::string
+route_state(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int flags;
+        unsigned int count;
+        unsigned int data[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    json res;
+
+    std::vector<std::pair<unsigned int, unsigned int>> routes;
+    for (unsigned int i = 0; i < prms->count; i++) {
+        unsigned int output = prms->data[2*i];
+        unsigned int input  = prms->data[2*i+1];
+        if (output >= sys.mInterp->OutputCount() || input >= sys.mInterp->InputCount()) {
+            res["status"] = -1;
+            return res.dump();
+        }
+        routes.emplace_back(output, input);
+    }
+
+    if (prms->flags & 1) {
+        for (const auto& route : routes) {
+            TensorView view;
+            if (sys.mInterp->get_input_buffer(route.second, view)) {
+                memset(view.mData, 0, view.mBytes);
+            }
+        }
+    }
+
+    gRoute.swap(routes);
+
+    res["status"] = 0;
+    return res.dump();
+}
+
+/*** stream.cpp ***********************************************************}}}*/
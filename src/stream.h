@@ -0,0 +1,23 @@
+/***  File Header  ************************************************************/
+/**
+* stream.h
+*
+* Tiny ML streaming inputs and recurrent states
+* @author      Shozo Fukuda
+* @date create Fri Oct 23 10:42:18 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _STREAM_H
+#define _STREAM_H
+
+/**************************************************************************}}}**
+*
+***************************************************************************{{{*/
+int  set_input_stream(TinyMLInterp* interp, const void* args);
+void close_input_stream(unsigned int index);
+bool invoke_stream(TinyMLInterp* interp);
+
+std::string route_state(SysInfo& sys, const void* args);
+
+#endif /* _STREAM_H */
@@ -0,0 +1,411 @@
+/***  File Header  ************************************************************/
+/**
+* tensor_conv.cpp
+*
+* conversion kernels for the input tensor
+* @author   Shozo Fukuda
+* @date     create Mon Oct 19 09:12:44 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "tensor_conv.h"
+
+#if defined(__AVX2__) || defined(__F16C__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*--- CONSTANT ---*/
+// lanes of the widest vector: the period of affine parameters is a multiple of it.
+const size_t VLEN = 16;
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* half precision to single precision
+* @par DESCRIPTION
+*   convert one IEEE754 binary16 to binary32.
+*
+* @retval converted value
+**/
+/**************************************************************************{{{*/
+static inline float
+half_to_float(uint16_t h)
+{
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t expo = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x03ff;
+    uint32_t bits;
+
+    if (expo == 0x1f) {
+        // inf or nan
+        bits = sign | 0x7f800000 | (mant << 13);
+    }
+    else if (expo != 0) {
+        // normalized number
+        bits = sign | ((expo + (127 - 15)) << 23) | (mant << 13);
+    }
+    else if (mant != 0) {
+        // subnormal number -> normalize it
+        expo = 127 - 15 + 1;
+        while ((mant & 0x0400) == 0) {
+            mant <<= 1;
+            expo--;
+        }
+        bits = sign | (expo << 23) | ((mant & 0x03ff) << 13);
+    }
+    else {
+        // signed zero
+        bits = sign;
+    }
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* widen f16 array to f32 array
+* @par DESCRIPTION
+*   "src" is a little endian f16 array, which may not be aligned.
+*
+**/
+/**************************************************************************{{{*/
+void
+f16_to_f32(float* dst, const uint8_t* src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    for (; i + 16 <= count; i += 16) {
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2*i));
+        _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(h));
+    }
+#endif
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        uint16x4_t h = vreinterpret_u16_u8(vld1_u8(src + 2*i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(h)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint16_t h;
+        memcpy(&h, src + 2*i, sizeof(h));
+        dst[i] = half_to_float(h);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* u8 -> f32 affine conversion
+* @par DESCRIPTION
+*   dst[i] = src[i]*scale[i % period] + bias[i % period]
+*   "period" must be a multiple of VLEN.
+*
+**/
+/**************************************************************************{{{*/
+static void
+u8_affine(float* dst, const uint8_t* src, size_t count, const float* scale, const float* bias, size_t period)
+{
+    size_t i = 0;
+
+    for (; i + period <= count; i += period) {
+        for (size_t j = 0; j < period; j += VLEN) {
+            const uint8_t* s = src + i + j;
+            float*         d = dst + i + j;
+            const float*   a = scale + j;
+            const float*   b = bias  + j;
+#if defined(__AVX512F__)
+            __m512 x = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s))));
+            _mm512_storeu_ps(d, _mm512_fmadd_ps(x, _mm512_loadu_ps(a), _mm512_loadu_ps(b)));
+#elif defined(__AVX2__)
+            for (size_t k = 0; k < VLEN; k += 8) {
+                __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + k))));
+#if defined(__FMA__)
+                _mm256_storeu_ps(d + k, _mm256_fmadd_ps(x, _mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k)));
+#else
+                _mm256_storeu_ps(d + k, _mm256_add_ps(_mm256_mul_ps(x, _mm256_loadu_ps(a + k)), _mm256_loadu_ps(b + k)));
+#endif
+            }
+#elif defined(__ARM_NEON)
+            for (size_t k = 0; k < VLEN; k += 8) {
+                uint16x8_t x16 = vmovl_u8(vld1_u8(s + k));
+                float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(x16)));
+                float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(x16)));
+                vst1q_f32(d + k,     vmlaq_f32(vld1q_f32(b + k),     lo, vld1q_f32(a + k)));
+                vst1q_f32(d + k + 4, vmlaq_f32(vld1q_f32(b + k + 4), hi, vld1q_f32(a + k + 4)));
+            }
+#else
+            for (size_t k = 0; k < VLEN; k++) {
+                d[k] = s[k]*a[k] + b[k];
+            }
+#endif
+        }
+    }
+
+    for (size_t j = 0; i < count; i++, j++) {
+        dst[i] = src[i]*scale[j] + bias[j];
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* u8 -> f32 conversion
+* @par DESCRIPTION
+*   dst[i] = src[i]*scale + bias
+*
+**/
+/**************************************************************************{{{*/
+void
+u8_to_f32(float* dst, const uint8_t* src, size_t count, float scale, float bias)
+{
+    float a[VLEN], b[VLEN];
+    for (size_t j = 0; j < VLEN; j++) {
+        a[j] = scale;
+        b[j] = bias;
+    }
+
+    u8_affine(dst, src, count, a, b, VLEN);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* u8 -> f32 conversion with per-channel parameters
+* @par DESCRIPTION
+*   dst[i] = src[i]*scale[c] + bias[c], where c = (i / inner) % channels.
+*   "inner" is 1 for NHWC (interleaved channels) and H*W for NCHW (planar).
+*
+**/
+/**************************************************************************{{{*/
+void
+u8_to_f32(float* dst, const uint8_t* src, size_t count,
+          const float* scale, const float* bias, size_t channels, size_t inner)
+{
+    if (channels == 0) {
+        return;
+    }
+
+    if (inner > 1) {
+        // planar: every plane has the constant parameters.
+        for (size_t i = 0, c = 0; i < count; i += inner, c = (c + 1) % channels) {
+            size_t n = (count - i < inner) ? count - i : inner;
+            u8_to_f32(dst + i, src + i, n, scale[c], bias[c]);
+        }
+    }
+    else {
+        // interleaved: unroll the parameters to the period of channels x VLEN.
+        size_t period = channels*VLEN;
+        std::vector<float> a(period), b(period);
+        for (size_t j = 0; j < period; j++) {
+            a[j] = scale[j % channels];
+            b[j] = bias[j % channels];
+        }
+
+        u8_affine(dst, src, count, a.data(), b.data(), period);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* maximum of f32 array
+* @par DESCRIPTION
+*   "count" must be > 0. NaN is not taken care of.
+*
+* @retval maximum value
+**/
+/**************************************************************************{{{*/
+float
+max_f32(const float* src, size_t count)
+{
+    size_t i = 0;
+    float  m = src[0];
+
+#if defined(__AVX512F__)
+    if (count >= 16) {
+        __m512 v = _mm512_loadu_ps(src);
+        for (i = 16; i + 16 <= count; i += 16) {
+            v = _mm512_max_ps(v, _mm512_loadu_ps(src + i));
+        }
+        m = _mm512_reduce_max_ps(v);
+    }
+#elif defined(__AVX2__)
+    if (count >= 8) {
+        __m256 v = _mm256_loadu_ps(src);
+        for (i = 8; i + 8 <= count; i += 8) {
+            v = _mm256_max_ps(v, _mm256_loadu_ps(src + i));
+        }
+        __m128 h = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+        h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+        m = _mm_cvtss_f32(h);
+    }
+#elif defined(__aarch64__)
+    if (count >= 4) {
+        float32x4_t v = vld1q_f32(src);
+        for (i = 4; i + 4 <= count; i += 4) {
+            v = vmaxq_f32(v, vld1q_f32(src + i));
+        }
+        m = vmaxvq_f32(v);
+    }
+#endif
+
+    for (; i < count; i++) {
+        m = (src[i] > m) ? src[i] : m;
+    }
+    return m;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* one step of the element-wise argmax
+* @par DESCRIPTION
+*   fold the candidate src with the index id into the running maximum:
+*   best[i], idx[i] = src[i], id  if src[i] > best[i].
+*   the SSE2 code keeps the baseline x86-64 build vectorized.
+*
+**/
+/**************************************************************************{{{*/
+void
+argmax_f32(float* best, uint32_t* idx, const float* src, uint32_t id, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    const __m512i vid = _mm512_set1_epi32(static_cast<int>(id));
+    for (; i + 16 <= count; i += 16) {
+        __m512    x  = _mm512_loadu_ps(src + i);
+        __m512    b  = _mm512_loadu_ps(best + i);
+        __mmask16 gt = _mm512_cmp_ps_mask(x, b, _CMP_GT_OQ);
+        _mm512_storeu_ps(best + i, _mm512_mask_mov_ps(b, gt, x));
+        _mm512_storeu_si512(idx + i, _mm512_mask_mov_epi32(_mm512_loadu_si512(idx + i), gt, vid));
+    }
+#elif defined(__AVX2__)
+    const __m256 vid = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(id)));
+    for (; i + 8 <= count; i += 8) {
+        __m256 x  = _mm256_loadu_ps(src + i);
+        __m256 b  = _mm256_loadu_ps(best + i);
+        __m256 gt = _mm256_cmp_ps(x, b, _CMP_GT_OQ);
+        __m256 ix = _mm256_loadu_ps(reinterpret_cast<const float*>(idx + i));
+        _mm256_storeu_ps(best + i, _mm256_blendv_ps(b, x, gt));
+        _mm256_storeu_ps(reinterpret_cast<float*>(idx + i), _mm256_blendv_ps(ix, vid, gt));
+    }
+#elif defined(__aarch64__)
+    const uint32x4_t vid = vdupq_n_u32(id);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x  = vld1q_f32(src + i);
+        float32x4_t b  = vld1q_f32(best + i);
+        uint32x4_t  gt = vcgtq_f32(x, b);
+        vst1q_f32(best + i, vbslq_f32(gt, x, b));
+        vst1q_u32(idx + i, vbslq_u32(gt, vid, vld1q_u32(idx + i)));
+    }
+#elif defined(__SSE2__)
+    const __m128i vid = _mm_set1_epi32(static_cast<int>(id));
+    for (; i + 4 <= count; i += 4) {
+        __m128  x  = _mm_loadu_ps(src + i);
+        __m128  b  = _mm_loadu_ps(best + i);
+        __m128i gt = _mm_castps_si128(_mm_cmpgt_ps(x, b));
+        __m128i ix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + i));
+        _mm_storeu_ps(best + i, _mm_max_ps(x, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(idx + i), _mm_or_si128(_mm_and_si128(gt, vid), _mm_andnot_si128(gt, ix)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        bool gt = src[i] > best[i];
+        best[i] = gt ? src[i] : best[i];
+        idx[i]  = gt ? id : idx[i];
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* element-wise maximum of three
+* @par DESCRIPTION
+*   dst[i] = max(a[i], b[i], c[i]). a pass of the 3x3 max pooling.
+*
+**/
+/**************************************************************************{{{*/
+void
+max3_f32(float* dst, const float* a, const float* b, const float* c, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    for (; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_max_ps(_mm512_max_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)), _mm512_loadu_ps(c + i)));
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_max_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)), _mm256_loadu_ps(c + i)));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmaxq_f32(vmaxq_f32(vld1q_f32(a + i), vld1q_f32(b + i)), vld1q_f32(c + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_max_ps(_mm_max_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)), _mm_loadu_ps(c + i)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = std::max(std::max(a[i], b[i]), c[i]);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* scaled accumulation
+* @par DESCRIPTION
+*   dst[i] += a*src[i]. a row of the small GEMMs in the post processing.
+*
+**/
+/**************************************************************************{{{*/
+void
+axpy_f32(float* dst, const float* src, float a, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    const __m512 va = _mm512_set1_ps(a);
+    for (; i + 16 <= count; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(src + i), _mm512_loadu_ps(dst + i)));
+    }
+#elif defined(__AVX2__)
+    const __m256 va = _mm256_set1_ps(a);
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(va, _mm256_loadu_ps(src + i))));
+    }
+#elif defined(__aarch64__)
+    const float32x4_t va = vdupq_n_f32(a);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vfmaq_f32(vld1q_f32(dst + i), va, vld1q_f32(src + i)));
+    }
+#elif defined(__SSE2__)
+    const __m128 va = _mm_set1_ps(a);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(va, _mm_loadu_ps(src + i))));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] += a*src[i];
+    }
+}
+
+/*** tensor_conv.cpp ******************************************************}}}*/
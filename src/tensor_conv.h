@@ -0,0 +1,39 @@
+/***  File Header  ************************************************************/
+/**
+* @file tensor_conv.h
+*
+* conversion kernels for the input tensor
+* @author   Shozo Fukuda
+* @date     create Mon Oct 19 09:12:44 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _TENSOR_CONV_H
+#define _TENSOR_CONV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************}}}**
+* conversion kernels
+*   SIMD code is selected at compile time (F16C/AVX2/AVX-512 on x86, NEON on
+*   AArch64) and falls back to the scalar code on the others.
+***************************************************************************{{{*/
+void f16_to_f32(float* dst, const uint8_t* src, size_t count);
+void u8_to_f32(float* dst, const uint8_t* src, size_t count, float scale, float bias);
+void u8_to_f32(float* dst, const uint8_t* src, size_t count,
+               const float* scale, const float* bias, size_t channels, size_t inner);
+
+/**************************************************************************}}}**
+* reduction kernels for the output tensor
+***************************************************************************{{{*/
+float max_f32(const float* src, size_t count);
+void  argmax_f32(float* best, uint32_t* idx, const float* src, uint32_t id, size_t count);
+void  max3_f32(float* dst, const float* a, const float* b, const float* c, size_t count);
+
+/**************************************************************************}}}**
+* linear algebra kernels
+***************************************************************************{{{*/
+void axpy_f32(float* dst, const float* src, float a, size_t count);
+
+#endif /* _TENSOR_CONV_H */
@@ -41,6 +41,14 @@ TensorSpec::TensorSpec(std::string spec, bool alloc_blob)
         mDType = DTYPE_U32;
         element_size = 4;
     }
+    else if (chunk == "i64") {
+        mDType = DTYPE_I64;
+        element_size = 8;
+    }
+    else if (chunk == "f16") {
+        mDType = DTYPE_F16;
+        element_size = 2;
+    }
     else if (chunk == "f32") {
         mDType = DTYPE_F32;
         element_size = 4;
@@ -115,6 +123,35 @@ parse_tensor_spec(std::string& specs, bool alloc_blob)
     return tensor_specs;
 }
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* size of the tensor element
+* @par DESCRIPTION
+*   return byte size of the element of "dtype".
+**/
+/**************************************************************************{{{*/
+size_t
+dtype_size(TensorSpec::DType dtype)
+{
+    switch (dtype) {
+    case TensorSpec::DTYPE_U8:
+    case TensorSpec::DTYPE_I8:
+        return 1;
+    case TensorSpec::DTYPE_U16:
+    case TensorSpec::DTYPE_I16:
+    case TensorSpec::DTYPE_F16:
+        return 2;
+    case TensorSpec::DTYPE_F32:
+    case TensorSpec::DTYPE_I32:
+    case TensorSpec::DTYPE_U32:
+        return 4;
+    case TensorSpec::DTYPE_I64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
 /***  Module Header  ******************************************************}}}*/
 /**
 * print tensor spec
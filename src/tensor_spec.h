@@ -33,6 +33,8 @@ struct TensorSpec {
       DTYPE_U16,
       DTYPE_I16,
       DTYPE_I32,
+      DTYPE_I64,
+      DTYPE_F16 = 10,
       DTYPE_U32 = 12,
     };
 
@@ -55,7 +57,32 @@ struct TensorSpec {
     uint8_t*             mBlob { nullptr };
 };
 
+/***  Class Header  *******************************************************}}}*/
+/**
+* Tensor view
+* @par DESCRIPTION
+*   raw buffer of the tensor held in the backend framework.
+**/
+/**************************************************************************{{{*/
+struct TensorView {
+//INQUIRY:
+    size_t count() const {
+        size_t prod = 1;
+        for (const auto& item : mShape) {
+            prod *= static_cast<size_t>(item);
+        }
+        return prod;
+    }
+
+//ATTRIBUTE:
+    void*                mData  { nullptr };
+    size_t               mBytes { 0 };
+    TensorSpec::DType    mDType { TensorSpec::DTYPE_NONE };
+    std::vector<int64_t> mShape;
+};
+
 std::vector<TensorSpec*> parse_tensor_spec(std::string& specs, bool alloc_blob=false);
+size_t dtype_size(TensorSpec::DType dtype);
 
 std::ostream& operator<<(std::ostream& s, TensorSpec t);
 
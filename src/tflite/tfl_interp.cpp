@@ -20,6 +20,32 @@
 
 void add_custom_operations(tflite::ops::builtin::BuiltinOpResolver& resolver);
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* convert TfLiteType to dtype of TensorSpec
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static TensorSpec::DType
+to_dtype(TfLiteType type)
+{
+    switch (type) {
+    case kTfLiteFloat32: return TensorSpec::DTYPE_F32;
+    case kTfLiteUInt8:   return TensorSpec::DTYPE_U8;
+    case kTfLiteInt8:    return TensorSpec::DTYPE_I8;
+    case kTfLiteUInt16:  return TensorSpec::DTYPE_U16;
+    case kTfLiteInt16:   return TensorSpec::DTYPE_I16;
+    case kTfLiteInt32:   return TensorSpec::DTYPE_I32;
+    case kTfLiteInt64:   return TensorSpec::DTYPE_I64;
+    case kTfLiteFloat16: return TensorSpec::DTYPE_F16;
+    case kTfLiteUInt32:  return TensorSpec::DTYPE_U32;
+    default:             return TensorSpec::DTYPE_NONE;
+    }
+}
+
 /***  Module Header  ******************************************************}}}*/
 /**
 * initialize interpreter
@@ -137,29 +163,39 @@ TflInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size)
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* set input tensor
+* execute inference
 * @par DESCRIPTION
 *
 *
 * @retval
 **/
 /**************************************************************************{{{*/
-int
-TflInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size, std::function<float(uint8_t)> conv)
+bool
+TflInterp::invoke()
 {
-    TfLiteTensor* itensor = mInterpreter->input_tensor(index);
-    float* dst = itensor->data.f;
-    const uint8_t* src = data;
-    for (int i = 0; i < size; i++) {
-        *dst++ = conv(*src++);
-    }
-    
-    return size;
+    mInterpreter->Invoke();
+    return true;
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* execute inference
+* get result tensor
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+std::string
+TflInterp::get_output_tensor(unsigned int index)
+{
+    TfLiteTensor* otensor = mInterpreter->output_tensor(index);
+    return std::string(otensor->data.raw, otensor->bytes);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* get raw buffer of input tensor
 * @par DESCRIPTION
 *
 *
@@ -167,26 +203,89 @@ TflInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size, s
 **/
 /**************************************************************************{{{*/
 bool
-TflInterp::invoke()
+TflInterp::get_input_buffer(unsigned int index, TensorView& view)
 {
-    mInterpreter->Invoke();
+    TfLiteTensor* itensor = mInterpreter->input_tensor(index);
+    if (itensor == nullptr) {
+        return false;
+    }
+
+    view.mData  = itensor->data.raw;
+    view.mBytes = itensor->bytes;
+    view.mDType = to_dtype(itensor->type);
+    view.mShape.assign(itensor->dims->data, itensor->dims->data + itensor->dims->size);
+
     return true;
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* get result tensor
+* get raw buffer of output tensor
 * @par DESCRIPTION
-*
+*   valid until the next invoke.
 *
 * @retval
 **/
 /**************************************************************************{{{*/
-std::string
-TflInterp::get_output_tensor(unsigned int index)
+bool
+TflInterp::get_output_buffer(unsigned int index, TensorView& view)
 {
     TfLiteTensor* otensor = mInterpreter->output_tensor(index);
-    return std::string(otensor->data.raw, otensor->bytes);
+    if (otensor == nullptr) {
+        return false;
+    }
+
+    view.mData  = otensor->data.raw;
+    view.mBytes = otensor->bytes;
+    view.mDType = to_dtype(otensor->type);
+    view.mShape.assign(otensor->dims->data, otensor->dims->data + otensor->dims->size);
+
+    return true;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* resize input tensor
+* @par DESCRIPTION
+*   resize the input tensor and re-allocate the tensors. the contents of
+*   the other inputs are kept over the re-allocation.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+bool
+TflInterp::resize_input_tensor(unsigned int index, const std::vector<int64_t>& shape)
+{
+    TfLiteTensor* itensor = mInterpreter->input_tensor(index);
+    if (itensor == nullptr) {
+        return false;
+    }
+    if (std::vector<int64_t>(itensor->dims->data, itensor->dims->data + itensor->dims->size) == shape) {
+        return true;
+    }
+
+    std::vector<std::string> keep(mInputCount);
+    for (unsigned int i = 0; i < mInputCount; i++) {
+        TfLiteTensor* t = mInterpreter->input_tensor(i);
+        if (i != index && t->data.raw != nullptr) {
+            keep[i].assign(t->data.raw, t->bytes);
+        }
+    }
+
+    std::vector<int> dims(shape.begin(), shape.end());
+    if (mInterpreter->ResizeInputTensor(mInterpreter->inputs()[index], dims) != kTfLiteOk
+    ||  mInterpreter->AllocateTensors() != kTfLiteOk) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < mInputCount; i++) {
+        TfLiteTensor* t = mInterpreter->input_tensor(i);
+        if (!keep[i].empty() && keep[i].size() == t->bytes) {
+            memcpy(t->data.raw, keep[i].data(), t->bytes);
+        }
+    }
+
+    return true;
 }
 
 /*** tfl_interp.cc ********************************************************}}}*/
@@ -45,9 +45,11 @@ public:
 public:
     void info(json& res);
     int set_input_tensor(unsigned int index, const uint8_t* data, int size);
-    int set_input_tensor(unsigned int index, const uint8_t* data, int size, std::function<float(uint8_t)> conv);
     bool invoke();
     std::string get_output_tensor(unsigned int index);
+    bool get_input_buffer(unsigned int index, TensorView& view);
+    bool get_output_buffer(unsigned int index, TensorView& view);
+    bool resize_input_tensor(unsigned int index, const std::vector<int64_t>& shape);
 
 //ACCESSOR:
 public:
@@ -0,0 +1,145 @@
+/***  File Header  ************************************************************/
+/**
+* thread_pool.cpp
+*
+* worker threads for the pre/post processing
+* @author   Shozo Fukuda
+* @date     create Mon Oct 19 14:03:51 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include "tiny_ml.h"
+#include "thread_pool.h"
+
+/***  Method Header  ******************************************************}}}*/
+/**
+* constructor
+* @par DESCRIPTION
+*   start the workers.
+**/
+/**************************************************************************{{{*/
+ThreadPool::ThreadPool(unsigned int num_thread)
+{
+    for (unsigned int i = 0; i < num_thread; i++) {
+        mWorker.emplace_back([this]() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCond.wait(lock, [this]() { return mStop || !mTask.empty(); });
+                    if (mStop && mTask.empty()) {
+                        return;
+                    }
+                    task = std::move(mTask.front());
+                    mTask.pop();
+                }
+                task();
+            }
+        });
+    }
+}
+
+/***  Method Header  ******************************************************}}}*/
+/**
+* destructor
+* @par DESCRIPTION
+*   finish the remaining tasks and join the workers.
+**/
+/**************************************************************************{{{*/
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCond.notify_all();
+
+    for (auto& worker : mWorker) {
+        worker.join();
+    }
+}
+
+/***  Method Header  ******************************************************}}}*/
+/**
+* parallel for
+* @par DESCRIPTION
+*   the caller runs the first chunk itself and waits for the others.
+**/
+/**************************************************************************{{{*/
+void
+ThreadPool::parallel_for(size_t count, std::function<void(size_t, size_t)> func, size_t grain)
+{
+    size_t num_chunk = mWorker.size() + 1;
+    if (grain == 0) { grain = 1; }
+    if (count < num_chunk*grain) {
+        num_chunk = (count + grain - 1)/grain;
+    }
+    if (num_chunk <= 1) {
+        if (count > 0) { func(0, count); }
+        return;
+    }
+
+    size_t chunk = (count + num_chunk - 1)/num_chunk;
+
+    std::vector<std::future<void>> pending;
+    for (size_t begin = chunk; begin < count; begin += chunk) {
+        size_t end = (begin + chunk < count) ? begin + chunk : count;
+        pending.push_back(submit([&func, begin, end]() { func(begin, end); }));
+    }
+
+    func(0, chunk);
+
+    // help the workers while waiting, so that nested parallel_for never deadlocks.
+    for (auto& item : pending) {
+        while (item.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!run_pending_task()) {
+                item.wait();
+            }
+        }
+        item.get();
+    }
+}
+
+/***  Method Header  ******************************************************}}}*/
+/**
+* run a pending task
+* @par DESCRIPTION
+*   pop a task from the queue and run it on the caller's thread.
+*
+* @retval true  a task was run
+* @retval false the queue is empty
+**/
+/**************************************************************************{{{*/
+bool
+ThreadPool::run_pending_task()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mTask.empty()) {
+            return false;
+        }
+        task = std::move(mTask.front());
+        mTask.pop();
+    }
+    task();
+    return true;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* shared thread pool
+* @par DESCRIPTION
+*   created at the first use with "-j" threads (the caller is one of them).
+**/
+/**************************************************************************{{{*/
+ThreadPool&
+thread_pool()
+{
+    static ThreadPool pool((gSys.mNumThread > 1) ? gSys.mNumThread - 1 : 0);
+    return pool;
+}
+
+/*** thread_pool.cpp ******************************************************}}}*/
@@ -0,0 +1,79 @@
+/***  File Header  ************************************************************/
+/**
+* @file thread_pool.h
+*
+* worker threads for the pre/post processing
+* @author   Shozo Fukuda
+* @date     create Mon Oct 19 14:03:51 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* Thread pool
+* @par DESCRIPTION
+*   fixed number of workers consuming the task queue.
+*
+**/
+/**************************************************************************{{{*/
+class ThreadPool {
+//LIFECYCLE:
+public:
+    ThreadPool(unsigned int num_thread);
+    ~ThreadPool();
+
+//ACTION:
+public:
+    // run "task" on a worker and return its future.
+    // without workers ("-j 1"), it runs on the caller's thread at once.
+    template <class F>
+    auto submit(F task) -> std::future<decltype(task())> {
+        auto job = std::make_shared<std::packaged_task<decltype(task())()>>(task);
+        auto res = job->get_future();
+        if (mWorker.empty()) {
+            (*job)();
+            return res;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTask.emplace([job](){ (*job)(); });
+        }
+        mCond.notify_one();
+        return res;
+    }
+
+    // split [0, count) into chunks and run "func(begin, end)" on the workers.
+    void parallel_for(size_t count, std::function<void(size_t, size_t)> func, size_t grain=1);
+
+//IMPLEMENTATION:
+private:
+    bool run_pending_task();
+
+//INQUIRY:
+public:
+    size_t size() const { return mWorker.size(); }
+
+//ATTRIBUTE:
+private:
+    std::vector<std::thread>          mWorker;
+    std::queue<std::function<void()>> mTask;
+    std::mutex                        mMutex;
+    std::condition_variable           mCond;
+    bool                              mStop{false};
+};
+
+ThreadPool& thread_pool();
+
+#endif /* _THREAD_POOL_H */
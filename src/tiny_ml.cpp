@@ -11,9 +11,19 @@
 /**************************************************************************{{{*/
 
 #include <stdio.h>
+#include <string.h>
 #include <fstream>
+#include <algorithm>
+#include <iterator>
 
 #include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "preprocess.h"
+#include "audio.h"
+#include "tokenizer.h"
+#include "generate.h"
+#include "stream.h"
+#include "store.h"
 #include "postprocess.h"
 
 /***  Module Header  ******************************************************}}}*/
@@ -33,20 +43,176 @@ info(SysInfo& sys, const void*)
     res["exe"  ]   = sys.mExe;
     res["model"]   = sys.mModelPath;
     res["label"]   = sys.mLabelPath;
+    if (!sys.mTokenizer.empty()) {
+        res["tokenizer"] = sys.mTokenizer;
+    }
     res["class"]   = sys.mNumClass;
     res["thread"]  = sys.mNumThread;
 
     sys.mInterp->info(res);
+    store_info(sys, res);
 
     json lap_time;
     lap_time["input"]  = sys.mLap[0].count();
     lap_time["exec"]   = sys.mLap[1].count();
     lap_time["output"] = sys.mLap[2].count();
+    lap_time["load"]   = sys.mLoadTime.count();
     res["times"] = lap_time;
 
+#ifdef __linux__
+    // resident set size of this process [kB]
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            res["rss"] = std::stol(line.substr(6));
+            break;
+        }
+    }
+#endif
+
     return res.dump();
 }
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* set half precision data to input tensor
+* @par DESCRIPTION
+*   FLOAT16 tensor receives the data as it is, and FLOAT tensor receives
+*   the widened data.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+set_input_tensor_f16(TinyMLInterp* interp, unsigned int index, const uint8_t* data, int size)
+{
+    TensorView view;
+    if (!interp->get_input_buffer(index, view)) {
+        return -1;
+    }
+
+    size_t count = size/2;
+    switch (view.mDType) {
+    case TensorSpec::DTYPE_F16:
+        if (2*count > view.mBytes) {
+            return -2;
+        }
+        memcpy(view.mData, data, 2*count);
+        break;
+
+    case TensorSpec::DTYPE_F32:
+        if (4*count > view.mBytes) {
+            return -2;
+        }
+        f16_to_f32(reinterpret_cast<float*>(view.mData), data, count);
+        break;
+
+    default:
+        return -3;
+    }
+
+    return size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set uint8 data to input tensor with normalization
+* @par DESCRIPTION
+*   convert uint8 data to float: x*scale[c] + bias[c].
+*   the channel axis is 1 for NCHW and the last axis for NHWC, and it must
+*   be "channels" long (-3).
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+set_input_tensor_u8(TinyMLInterp* interp, unsigned int index, const uint8_t* data, int size,
+                    const float* scale, const float* bias, unsigned int channels, unsigned int layout)
+{
+    TensorView view;
+    if (!interp->get_input_buffer(index, view)) {
+        return -1;
+    }
+    if (view.mDType != TensorSpec::DTYPE_F32) {
+        return -3;
+    }
+    if (4*static_cast<size_t>(size) > view.mBytes) {
+        return -2;
+    }
+
+    float* dst = reinterpret_cast<float*>(view.mData);
+
+    if (channels <= 1) {
+        u8_to_f32(dst, data, size, scale[0], bias[0]);
+    }
+    else if (layout == 0 && view.mShape.size() >= 2) {
+        // NCHW
+        if (view.mShape[1] != static_cast<int64_t>(channels)) {
+            return -3;
+        }
+        size_t inner = 1;
+        for (size_t i = 2; i < view.mShape.size(); i++) {
+            inner *= view.mShape[i];
+        }
+        u8_to_f32(dst, data, size, scale, bias, channels, inner);
+    }
+    else {
+        // NHWC
+        if (view.mShape.empty() || view.mShape.back() != static_cast<int64_t>(channels)) {
+            return -3;
+        }
+        u8_to_f32(dst, data, size, scale, bias, channels, 1);
+    }
+
+    return size;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set uint8 data to input tensor with per-channel normalization
+* @par DESCRIPTION
+*   (x - mean[c])/std[c]
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+set_input_tensor_gauss(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        unsigned int index;
+        unsigned int dtype;
+        unsigned int layout;        // 0:NCHW, 1:NHWC
+        unsigned int channels;
+        float        gauss[1];      // {mean, std} x channels, followed by data
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int head_size = sizeof(Prms) - sizeof(float) + 2*sizeof(float)*prms->channels;
+    const int data_size = prms_size - head_size;
+
+    if (prms->channels == 0 || data_size < 0) {
+        return -2;
+    }
+
+    const uint8_t* gauss = reinterpret_cast<const uint8_t*>(args) + sizeof(Prms) - sizeof(float);
+    std::vector<float> scale(prms->channels), bias(prms->channels);
+    for (unsigned int c = 0; c < prms->channels; c++) {
+        float mean_std[2];
+        memcpy(mean_std, gauss + 2*sizeof(float)*c, sizeof(mean_std));
+        scale[c] = 1.0f/mean_std[1];
+        bias[c]  = -mean_std[0]/mean_std[1];
+    }
+
+    int res = set_input_tensor_u8(interp, prms->index, reinterpret_cast<const uint8_t*>(args) + head_size, data_size,
+                                  scale.data(), bias.data(), prms->channels, prms->layout);
+
+    return (res < 0) ? res : prms_size;
+}
+
 /***  Module Header  ******************************************************}}}*/
 /**
 * set input tensor
@@ -78,6 +244,14 @@ set_input_tensor(TinyMLInterp* interp, const void* args)
         return -1;
     }
 
+    // the tensor may be being written by the decode job.
+    wait_input_image(prms->index);
+
+    // the tensor set in the other ways leaves the sliding window.
+    if (prms->dtype != 9) {
+        close_input_stream(prms->index);
+    }
+
     switch (prms->dtype) {
     case 0:
         res = interp->set_input_tensor(prms->index, prms->data, data_size);
@@ -85,13 +259,43 @@ set_input_tensor(TinyMLInterp* interp, const void* args)
 
     case 1:
         {
-        double a = (prms->max - prms->min)/255.0;
-        double b = prms->min;
-        res = interp->set_input_tensor(prms->index, prms->data, data_size,
-                                       [a,b](uint8_t x){ return static_cast<float>(a*x + b); });
+        float a = static_cast<float>((prms->max - prms->min)/255.0);
+        float b = prms->min;
+        res = set_input_tensor_u8(interp, prms->index, prms->data, data_size, &a, &b, 1, 0);
         }
         break;
 
+    case 2:
+        res = set_input_tensor_f16(interp, prms->index, prms->data, data_size);
+        break;
+
+    case 3:
+        return set_input_tensor_gauss(interp, args);
+
+    case 4:
+        return set_input_image(interp, args);
+
+    case 5:
+        return set_input_encoded_image(interp, args);
+
+    case 6:
+        return set_input_yuv(interp, args);
+
+    case 7:
+        return set_input_audio(interp, args);
+
+    case 8:
+        return set_input_text(interp, args);
+
+    case 9:
+        return set_input_stream(interp, args);
+
+    case 10:
+        return set_input_stored(interp, args);
+
+    case 11:
+        return set_input_patch(interp, args);
+
     default:
         return -3;
     }
@@ -109,6 +313,12 @@ set_input_tensor(SysInfo& sys, const void* args)
     int status = set_input_tensor(sys.mInterp, args);
     res["status"] = (status >= 0) ? 0 : status;
 
+    // geometry of the preprocessed image for later box mapping
+    unsigned int dtype = reinterpret_cast<const unsigned int*>(args)[2];
+    if (status >= 0 && (dtype == 4 || dtype == 6) && sys.mLetterbox.mValid) {
+        res["letterbox"] = { sys.mLetterbox.mScaleX, sys.mLetterbox.mScaleY, sys.mLetterbox.mOffsetX, sys.mLetterbox.mOffsetY };
+    }
+
     sys.LAP_INPUT();
 
     return res.dump();
@@ -130,7 +340,7 @@ invoke(SysInfo& sys, const void*)
 
     sys.start_watch();
 
-    res["status"] = sys.mInterp->invoke();
+    res["status"] = wait_input_image() && invoke_stream(sys.mInterp);
 
     sys.LAP_EXEC();
 
@@ -200,10 +410,16 @@ run(SysInfo& sys, const void* args)
         ptr += next;
     }
 
+    if (!wait_input_image()) {
+        // error about decoding the image: error_code -5
+        int status = -5;
+        return std::string(reinterpret_cast<char*>(&status), sizeof(status));
+    }
+
     sys.LAP_INPUT();
 
     // invoke
-    if (!sys.mInterp->invoke()) {
+    if (!invoke_stream(sys.mInterp)) {
         // error about invoke: error_code {-11..}
         int status = -11;
         return std::string(reinterpret_cast<char*>(&status), sizeof(status));
@@ -227,11 +443,72 @@ run(SysInfo& sys, const void* args)
     return output;
 }
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* select the method of the model
+* @par DESCRIPTION
+*   switch the entry point (ex. "encode_image") to which the following
+*   set_input_tensor/invoke/get_output_tensor are applied.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static int
+select_method(TinyMLInterp* interp, const void* args, int* prms_size=nullptr)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        char         name[1];
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    if (prms_size) {
+        *prms_size = sizeof(prms->size) + prms->size;
+    }
+
+    return interp->select_method(std::string(prms->name, prms->size));
+}
+
+std::string
+select_method(SysInfo& sys, const void* args)
+{
+    json res;
+
+    res["status"] = select_method(sys.mInterp, args);
+
+    return res.dump();
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* execute inference of the method in session mode
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+std::string
+run_method(SysInfo& sys, const void* args)
+{
+    int prms_size;
+    if (select_method(sys.mInterp, args, &prms_size) < 0) {
+        // error about method: error_code -4
+        int status = -4;
+        return std::string(reinterpret_cast<char*>(&status), sizeof(status));
+    }
+
+    return run(sys, reinterpret_cast<const uint8_t*>(args) + prms_size);
+}
+
 /**************************************************************************}}}**
 * command dispatch table
 ***************************************************************************{{{*/
 typedef std::string (TMLFunc)(SysInfo& sys, const void* args);
 
+std::string run_postprocess(SysInfo& sys, const void* args);
+
 TMLFunc* gCmdTbl[] = {
     info,
     set_input_tensor,
@@ -239,11 +516,149 @@ TMLFunc* gCmdTbl[] = {
     get_output_tensor,
     run,
 
-    POST_PROCESS
+    POST_PROCESS,
+
+    select_method,
+    run_method,
+
+    topk,
+    decode_detection,
+    non_max_suppression_batch,
+    run_postprocess,
+    segment_argmax,
+    keypoint_peaks,
+    ctc_decode,
+    generate,
+    route_state,
+    store_tensor,
 };
 
 const int gMaxCmd = sizeof(gCmdTbl)/sizeof(TMLFunc*);
 
+// post processors working on the output buffers, callable from run_postprocess.
+// the caller starts the watch: they lap only the output.
+TMLFunc* gPostTbl[] = {
+    topk,
+    decode_detection,
+    segment_argmax,
+    keypoint_peaks,
+    ctc_decode,
+};
+
+static bool
+is_post(unsigned int cmd)
+{
+    return cmd < static_cast<unsigned int>(gMaxCmd)
+        && std::find(std::begin(gPostTbl), std::end(gPostTbl), gCmdTbl[cmd]) != std::end(gPostTbl);
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* execute inference and post processing in one request
+* @par DESCRIPTION
+*   set the input tensors and invoke as run, then run the post processors
+*   directly over the output buffers. only their results come back.
+*   args: {count, input tensors.., num_post, {cmd, size, args[size]}..}
+*   the descriptors running past the packet are rejected (-2).
+*
+* @retval json {"status":0, "results":[result of each post processor..]}
+**/
+/**************************************************************************{{{*/
+std::string
+run_postprocess(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int  count;
+        unsigned char data[1];
+    });
+    PACK(
+    struct Post {
+        unsigned int  cmd;
+        unsigned int  size;
+        unsigned char args[1];
+    });
+    const Prms* prms = reinterpret_cast<const Prms*>(args);
+
+    auto error = [](int status) {
+        json res;
+        res["status"] = status;
+        return res.dump();
+    };
+
+    const unsigned char* end = reinterpret_cast<const unsigned char*>(args) + sys.mArgsSize;
+    auto fits = [&end](const unsigned char* ptr, size_t size) {
+        return ptr <= end && size <= static_cast<size_t>(end - ptr);
+    };
+    auto word = [](const unsigned char* ptr) {
+        unsigned int val;
+        memcpy(&val, ptr, sizeof(val));
+        return val;
+    };
+
+    sys.start_watch();
+
+    // set input tensors
+    if (!fits(reinterpret_cast<const unsigned char*>(args), sizeof(prms->count))) {
+        return error(-2);
+    }
+    const unsigned char* ptr = prms->data;
+    for (unsigned int i = 0; i < prms->count; i++) {
+        if (!fits(ptr, sizeof(unsigned int)) || !fits(ptr + sizeof(unsigned int), word(ptr))) {
+            return error(-2);
+        }
+        int next = set_input_tensor(sys.mInterp, ptr);
+        if (next < 0) {
+            return error(next);
+        }
+
+        ptr += next;
+    }
+
+    if (!wait_input_image()) {
+        return error(-5);
+    }
+
+    sys.LAP_INPUT();
+
+    // invoke
+    if (!invoke_stream(sys.mInterp)) {
+        return error(-11);
+    }
+
+    sys.LAP_EXEC();
+
+    // post processors
+    if (!fits(ptr, sizeof(unsigned int))) {
+        return error(-2);
+    }
+    unsigned int num_post = word(ptr);
+    ptr += sizeof(num_post);
+
+    std::string results;
+    chrono::milliseconds output(0);
+    for (unsigned int i = 0; i < num_post; i++) {
+        if (!fits(ptr, 2*sizeof(unsigned int)) || !fits(ptr + 2*sizeof(unsigned int), word(ptr + sizeof(unsigned int)))) {
+            return error(-2);
+        }
+        const Post* post = reinterpret_cast<const Post*>(ptr);
+        if (!is_post(post->cmd)) {
+            return error(-3);
+        }
+
+        if (i > 0) {
+            results += ",";
+        }
+        results += gCmdTbl[post->cmd](sys, post->args);
+        output  += sys.mLap[2];
+
+        ptr += 2*sizeof(unsigned int) + post->size;
+    }
+    sys.mLap[2] = output;
+
+    return "{\"status\":0,\"results\":[" + results + "]}";
+}
+
 /***  Module Header  ******************************************************}}}*/
 /**
 * tensor flow lite interpreter
@@ -254,7 +669,10 @@ const int gMaxCmd = sizeof(gCmdTbl)/sizeof(TMLFunc*);
 void
 interp(std::string& model, std::string& labels, std::string& inputs, std::string& outputs)
 {
+    gSys.start_watch();
     init_interp(gSys, model, inputs, outputs);
+    gSys.LAP_LOAD();
+    gSys.mLoadTime = gSys.mLap[3];
 
     // load labels
     if (labels != "none") {
@@ -274,6 +692,12 @@ interp(std::string& model, std::string& labels, std::string& inputs, std::string
         gSys.mNumClass = 0;
     }
 
+    // load tokenizer
+    if (!gSys.mTokenizer.empty() && load_tokenizer(gSys.mTokenizer) < 0) {
+        std::cerr << "error: Failed to load tokenizer\n";
+        exit(1);
+    }
+
     // REPL
     for (;;) {
         // receive command packet
@@ -290,6 +714,11 @@ interp(std::string& model, std::string& labels, std::string& inputs, std::string
             uint8_t        args[1];
         });
         const Cmd& call = *reinterpret_cast<const Cmd*>(cmd_line.data());
+        gSys.mArgsSize = (cmd_line.size() > sizeof(call.cmd)) ? cmd_line.size() - sizeof(call.cmd) : 0;
+
+        if (is_post(call.cmd)) {
+            gSys.start_watch();
+        }
 
         std::string&& result = (call.cmd < gMaxCmd) ? gCmdTbl[call.cmd](gSys, call.args)
                                                      : "unknown command";
@@ -50,9 +50,17 @@ public:
 public:
     virtual void info(json& res) = 0;
     virtual int set_input_tensor(unsigned int index, const uint8_t* data, int size) = 0;
-    virtual int set_input_tensor(unsigned int index, const uint8_t* data, int size, std::function<float(uint8_t)> conv) = 0;
     virtual bool invoke() = 0;
     virtual std::string get_output_tensor(unsigned int index) = 0;
+    virtual bool get_input_buffer(unsigned int index, TensorView& view) = 0;
+    virtual bool get_output_buffer(unsigned int index, TensorView& view) = 0;
+    virtual int select_method(const std::string& name) {
+        return (name.empty() || name == "forward") ? 0 : -1;
+    }
+    // change the shape of the input tensor along its dynamic axes
+    virtual bool resize_input_tensor(unsigned int, const std::vector<int64_t>&) {
+        return false;
+    }
 
 //INQUIRY:
 public:
@@ -74,8 +82,10 @@ struct SysInfo {
     std::string    mExe;       // path of this executable
     std::string    mModelPath; // path of Tflite Model
     std::string    mLabelPath; // path of Class Labels
+    std::string    mTokenizer; // tokenizer spec "<kind>:<path>"
     unsigned long mDiag;       // diagnosis mode
     int            mNumThread;  // number of thread
+    size_t         mStoreLimit; // capacity of the tensor store [bytes]
 
     TinyMLInterp* mInterp{nullptr};
 
@@ -85,6 +95,15 @@ struct SysInfo {
     // i/o method
     int (*mRcv)(std::string& cmd_line);
     int (*mSnd)(std::string result);
+    size_t mArgsSize{0};        // size of the args of the command in process
+
+    // geometry of the last preprocessed image: model_xy = image_xy*scale + offset
+    struct Letterbox {
+        bool  mValid{false};
+        float mScaleX, mScaleY;
+        float mOffsetX, mOffsetY;
+        int   mWidth, mHeight;    // size of the original image
+    } mLetterbox;
 
     std::string label(int id) {
         return (id < mLabel.size()) ? mLabel[id] : std::to_string(id);
@@ -93,6 +112,7 @@ struct SysInfo {
     // stop watch
     chrono::steady_clock::time_point mWatchStart;
     chrono::milliseconds mLap[NUM_LAP];
+    chrono::milliseconds mLoadTime{0};      // model loading, kept over the commands
 
     void reset_lap() {
         for (int i = 0; i < NUM_LAP; i++) { mLap[i] = chrono::milliseconds(0); }
@@ -111,6 +131,7 @@ struct SysInfo {
 #define LAP_INPUT()     lap(0)
 #define LAP_EXEC()      lap(1)
 #define LAP_OUTPUT()    lap(2)
+#define LAP_LOAD()      lap(3)
 
 extern SysInfo gSys;
 
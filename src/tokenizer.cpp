@@ -0,0 +1,868 @@
+/***  File Header  ************************************************************/
+/**
+* tokenizer.cpp
+*
+* Tiny ML pre processing libraies: text tokenizer
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 19:12:08 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "tiny_ml.h"
+#include "thread_pool.h"
+#include "preprocess.h"
+#include "tokenizer.h"
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* UTF-8
+* @par DESCRIPTION
+*   decode a code point at "pos" and advance it. a broken sequence yields
+*   U+FFFD and one byte.
+**/
+/**************************************************************************{{{*/
+static uint32_t
+next_cp(const std::string& s, size_t& pos)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(s.data()) + pos;
+    const size_t rest = s.size() - pos;
+
+    int      len;
+    uint32_t cp;
+    if      (p[0] < 0x80)           { len = 1; cp = p[0];        }
+    else if ((p[0] & 0xE0) == 0xC0) { len = 2; cp = p[0] & 0x1F; }
+    else if ((p[0] & 0xF0) == 0xE0) { len = 3; cp = p[0] & 0x0F; }
+    else if ((p[0] & 0xF8) == 0xF0) { len = 4; cp = p[0] & 0x07; }
+    else                            { pos += 1; return 0xFFFD;   }
+
+    if (static_cast<size_t>(len) > rest) {
+        pos += 1;
+        return 0xFFFD;
+    }
+    for (int i = 1; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            pos += 1;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    pos += len;
+    return cp;
+}
+
+static void
+put_cp(std::string& s, uint32_t cp)
+{
+    if (cp < 0x80) {
+        s += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        s += static_cast<char>(0xC0 | (cp >> 6));
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        s += static_cast<char>(0xE0 | (cp >> 12));
+        s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        s += static_cast<char>(0xF0 | (cp >> 18));
+        s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* character classes
+* @par DESCRIPTION
+*   a compact approximation of the Unicode categories used by the
+*   tokenizers: the common punctuation/symbol and digit blocks are listed,
+*   and the other printable characters are taken as letters.
+**/
+/**************************************************************************{{{*/
+static bool
+is_space(uint32_t cp)
+{
+    return cp == ' ' || (cp >= '\t' && cp <= '\r') || cp == 0x85 || cp == 0xA0
+        || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029
+        || cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+static bool
+is_control(uint32_t cp)
+{
+    return (cp < 0x20 || (cp >= 0x7F && cp <= 0x9F)) && !is_space(cp);
+}
+
+static bool
+is_number(uint32_t cp)
+{
+    return (cp >= '0' && cp <= '9') || cp == 0xB2 || cp == 0xB3 || cp == 0xB9
+        || (cp >= 0xBC && cp <= 0xBE)
+        || (cp >= 0x0660 && cp <= 0x0669) || (cp >= 0x06F0 && cp <= 0x06F9)
+        || (cp >= 0x0966 && cp <= 0x096F)
+        || (cp >= 0x2070 && cp <= 0x2079) || (cp >= 0x2080 && cp <= 0x2089)
+        || (cp >= 0x2150 && cp <= 0x2189) || (cp >= 0x2460 && cp <= 0x249B)
+        || cp == 0x3007 || (cp >= 0x3021 && cp <= 0x3029)
+        || (cp >= 0xFF10 && cp <= 0xFF19);
+}
+
+static bool
+is_punct(uint32_t cp)
+{
+    if (cp < 0x80) {
+        return (cp >= 33 && cp <= 47) || (cp >= 58 && cp <= 64)
+            || (cp >= 91 && cp <= 96) || (cp >= 123 && cp <= 126);
+    }
+    return (cp >= 0xA1 && cp <= 0xBF && cp != 0xAA && cp != 0xB5 && cp != 0xBA && !is_number(cp))
+        || cp == 0xD7 || cp == 0xF7
+        || (cp >= 0x0300 && cp <= 0x036F)       // combining marks
+        || (cp >= 0x2010 && cp <= 0x2BFF && !is_number(cp))
+        || (cp >= 0x2E00 && cp <= 0x2E7F)
+        || (cp >= 0x3001 && cp <= 0x303F && !is_number(cp))
+        || (cp >= 0xFE30 && cp <= 0xFE4F)
+        || (cp >= 0xFF01 && cp <= 0xFF0F) || (cp >= 0xFF1A && cp <= 0xFF20)
+        || (cp >= 0xFF3B && cp <= 0xFF40) || (cp >= 0xFF5B && cp <= 0xFF65)
+        || (cp >= 0x1F000 && cp <= 0x1FAFF);
+}
+
+static bool
+is_letter(uint32_t cp)
+{
+    if (cp < 0x80) {
+        return (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z');
+    }
+    return !is_space(cp) && !is_control(cp) && !is_number(cp) && !is_punct(cp);
+}
+
+static bool
+is_cjk(uint32_t cp)
+{
+    return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF)
+        || (cp >= 0x20000 && cp <= 0x2CEAF) || (cp >= 0xF900 && cp <= 0xFAFF)
+        || (cp >= 0x2F800 && cp <= 0x2FA1F);
+}
+
+static uint32_t
+to_lower(uint32_t cp)
+{
+    if (cp >= 'A' && cp <= 'Z') {
+        return cp + 0x20;
+    }
+    if (cp < 0xC0) {
+        return cp;
+    }
+    if ((cp >= 0xC0 && cp <= 0xDE && cp != 0xD7)
+    ||  (cp >= 0x0391 && cp <= 0x03A9 && cp != 0x03A2)
+    ||  (cp >= 0x0410 && cp <= 0x042F)
+    ||  (cp >= 0xFF21 && cp <= 0xFF3A)) {
+        return cp + 0x20;
+    }
+    if (cp >= 0x0400 && cp <= 0x040F) {
+        return cp + 0x50;
+    }
+    // Latin Extended-A: upper/lower pairs
+    if ((cp >= 0x0100 && cp <= 0x0137) || (cp >= 0x014A && cp <= 0x0177)) {
+        return cp | 1;
+    }
+    if ((cp >= 0x0139 && cp <= 0x0148) || (cp >= 0x0179 && cp <= 0x017E)) {
+        return (cp & 1) ? cp + 1 : cp;
+    }
+    return cp;
+}
+
+static uint32_t
+strip_accent(uint32_t cp)
+{
+    // lower case Latin-1 letters with the diacritic
+    static const char base[] = "aaaaaa\0ceeeeiiii\0nooooo\0\0uuuuy\0y";
+    if (cp >= 0xE0 && cp <= 0xFF && base[cp - 0xE0]) {
+        return base[cp - 0xE0];
+    }
+    return cp;
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* flat hash table of token pairs
+* @par DESCRIPTION
+*   open addressing table: (left id, right id) -> merged id.
+**/
+/**************************************************************************{{{*/
+class PairTable {
+//LIFECYCLE:
+public:
+    void reserve(size_t count) {
+        size_t cap = 16;
+        while (cap < 2*count) {
+            cap *= 2;
+        }
+        mMask = cap - 1;
+        mKey.assign(cap, static_cast<uint64_t>(EMPTY));
+        mVal.assign(cap, 0);
+    }
+
+//ACTION:
+public:
+    void insert(int32_t a, int32_t b, int32_t val) {
+        uint64_t key = make_key(a, b);
+        size_t i = slot(key);
+        while (mKey[i] != EMPTY && mKey[i] != key) {
+            i = (i + 1) & mMask;
+        }
+        mKey[i] = key;
+        mVal[i] = val;
+    }
+    int32_t find(int32_t a, int32_t b) const {
+        uint64_t key = make_key(a, b);
+        for (size_t i = slot(key); mKey[i] != EMPTY; i = (i + 1) & mMask) {
+            if (mKey[i] == key) {
+                return mVal[i];
+            }
+        }
+        return -1;
+    }
+
+protected:
+    static uint64_t make_key(int32_t a, int32_t b) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+    }
+    size_t slot(uint64_t key) const {
+        return static_cast<size_t>((key*0x9E3779B97F4A7C15ull) >> 32) & mMask;
+    }
+
+//ATTRIBUTE:
+protected:
+    static const uint64_t EMPTY = ~0ull;
+    size_t                mMask{0};
+    std::vector<uint64_t> mKey;
+    std::vector<int32_t>  mVal;
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* read lines of the text file (gzip compressed if USE_ZLIB)
+**/
+/**************************************************************************{{{*/
+static bool
+read_lines(const std::string& path, std::vector<std::string>& lines)
+{
+#ifdef USE_ZLIB
+    gzFile gz = gzopen(path.c_str(), "rb");
+    if (gz == nullptr) {
+        return false;
+    }
+    std::string line;
+    char buf[4096];
+    while (gzgets(gz, buf, sizeof(buf)) != nullptr) {
+        line += buf;
+        if (!line.empty() && line.back() == '\n') {
+            line.pop_back();
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            lines.emplace_back(std::move(line));
+            line.clear();
+        }
+    }
+    if (!line.empty()) {
+        lines.emplace_back(std::move(line));
+    }
+    gzclose(gz);
+    return true;
+#else
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+        return false;
+    }
+    std::ifstream file(path);
+    if (file.fail()) {
+        return false;
+    }
+    std::string line;
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        lines.emplace_back(std::move(line));
+    }
+    return true;
+#endif
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* CLIP byte-level BPE
+* @par DESCRIPTION
+*   same vocabulary as the CLIP simple tokenizer: 256 byte tokens, 256
+*   end-of-word byte tokens, the merges and <|startoftext|>/<|endoftext|>.
+**/
+/**************************************************************************{{{*/
+class ClipTokenizer : public Tokenizer {
+//LIFECYCLE:
+public:
+    bool load(const std::string& path);
+
+//ACTION:
+public:
+    virtual void encode(const std::string& text, std::vector<int32_t>& ids);
+
+protected:
+    void bpe(const std::string& word, std::vector<int32_t>& ids);
+
+//ATTRIBUTE:
+protected:
+    static const int NUM_MERGES = 49152 - 256 - 2;
+
+    int32_t   mByteId[256];     // byte -> token id
+    PairTable mMerge;
+
+    std::mutex mCacheLock;
+    std::unordered_map<std::string, std::vector<int32_t>> mCache;
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* load the merges file
+**/
+/**************************************************************************{{{*/
+bool
+ClipTokenizer::load(const std::string& path)
+{
+    std::vector<std::string> lines;
+    if (!read_lines(path, lines) || lines.size() < 2) {
+        return false;
+    }
+
+    // bytes to unicode: the printable bytes stand for themselves
+    std::unordered_map<std::string, int32_t> vocab;
+    vocab.reserve(2*NUM_MERGES);
+
+    int32_t id = 0, shifted = 0;
+    std::string unicode[256];
+    for (int pass = 0; pass < 2; pass++) {
+        for (int b = 0; b < 256; b++) {
+            bool printable = (b >= 33 && b <= 126) || (b >= 161 && b <= 172) || (b >= 174);
+            if (printable != (pass == 0)) {
+                continue;
+            }
+            put_cp(unicode[b], printable ? b : 256 + shifted++);
+            mByteId[b] = id++;
+        }
+    }
+    for (int b = 0; b < 256; b++) {
+        vocab[unicode[b]]          = mByteId[b];
+        vocab[unicode[b] + "</w>"] = mByteId[b] + 256;
+    }
+
+    // merges: skip the version line
+    size_t count = std::min(lines.size() - 1, static_cast<size_t>(NUM_MERGES));
+    mMerge.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const std::string& line = lines[i + 1];
+        size_t sep = line.find(' ');
+        if (sep == std::string::npos) {
+            return false;
+        }
+        std::string left  = line.substr(0, sep);
+        std::string right = line.substr(sep + 1);
+
+        auto a = vocab.find(left);
+        auto b = vocab.find(right);
+        if (a == vocab.end() || b == vocab.end()) {
+            return false;
+        }
+        int32_t merged = static_cast<int32_t>(512 + i);
+        mMerge.insert(a->second, b->second, merged);
+        vocab.emplace(left + right, merged);
+    }
+
+    mBos = static_cast<int32_t>(512 + count);
+    mEos = mBos + 1;
+    mPad = 0;
+
+    return true;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* BPE of a word
+* @par DESCRIPTION
+*   merge the pair of the lowest rank until no pair is mergeable.
+**/
+/**************************************************************************{{{*/
+void
+ClipTokenizer::bpe(const std::string& word, std::vector<int32_t>& ids)
+{
+    {
+        std::lock_guard<std::mutex> lock(mCacheLock);
+        auto it = mCache.find(word);
+        if (it != mCache.end()) {
+            ids.insert(ids.end(), it->second.begin(), it->second.end());
+            return;
+        }
+    }
+
+    std::vector<int32_t> token;
+    token.reserve(word.size());
+    for (unsigned char c : word) {
+        token.push_back(mByteId[c]);
+    }
+    token.back() += 256;        // </w>
+
+    while (token.size() > 1) {
+        int32_t best = -1;
+        size_t  pos  = 0;
+        for (size_t i = 0; i + 1 < token.size(); i++) {
+            int32_t merged = mMerge.find(token[i], token[i+1]);
+            if (merged >= 0 && (best < 0 || merged < best)) {
+                best = merged;
+                pos  = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        token[pos] = best;
+        token.erase(token.begin() + pos + 1);
+    }
+
+    ids.insert(ids.end(), token.begin(), token.end());
+
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    if (mCache.size() >= 65536) {
+        mCache.clear();
+    }
+    mCache.emplace(word, std::move(token));
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* encode the text
+* @par DESCRIPTION
+*   clean the whitespaces, lower the case and split into words by the
+*   pattern of CLIP:
+*     <|startoftext|>|<|endoftext|>|'s|'t|'re|'ve|'m|'ll|'d|\p{L}+|\p{N}|[^\s\p{L}\p{N}]+
+**/
+/**************************************************************************{{{*/
+void
+ClipTokenizer::encode(const std::string& text, std::vector<int32_t>& ids)
+{
+    // code points: whitespace cleaned and lower cased
+    std::vector<uint32_t> cps;
+    std::vector<size_t>   offs;     // byte offset of the lowered text
+    std::string lower;
+    for (size_t pos = 0; pos < text.size();) {
+        uint32_t cp = next_cp(text, pos);
+        if (is_space(cp)) {
+            if (cps.empty() || cps.back() == ' ') {
+                continue;
+            }
+            cp = ' ';
+        }
+        cp = to_lower(cp);
+        offs.push_back(lower.size());
+        cps.push_back(cp);
+        put_cp(lower, cp);
+    }
+    offs.push_back(lower.size());
+
+    static const char* specials[] = { "<|startoftext|>", "<|endoftext|>" };
+    static const char* suffixes[] = { "s", "t", "re", "ve", "m", "ll", "d" };
+
+    const size_t n = cps.size();
+    for (size_t i = 0; i < n;) {
+        uint32_t cp = cps[i];
+        const char* head = lower.c_str() + offs[i];
+
+        if (cp == '<') {
+            bool hit = false;
+            for (int k = 0; k < 2 && !hit; k++) {
+                size_t len = strlen(specials[k]);
+                if (strncmp(head, specials[k], len) == 0) {
+                    ids.push_back(k == 0 ? mBos : mEos);
+                    i  += len;
+                    hit = true;
+                }
+            }
+            if (hit) {
+                continue;
+            }
+        }
+
+        size_t j = i + 1;
+        if (cp == '\'') {
+            size_t len = 0;
+            for (auto sfx : suffixes) {
+                size_t l = strlen(sfx);
+                if (i + l < n && strncmp(head + 1, sfx, l) == 0) {
+                    len = l;
+                    break;
+                }
+            }
+            if (len > 0) {
+                j = i + 1 + len;
+            }
+            else {
+                while (j < n && !is_space(cps[j]) && !is_letter(cps[j]) && !is_number(cps[j])) j++;
+            }
+        }
+        else if (is_space(cp)) {
+            i++;
+            continue;
+        }
+        else if (is_letter(cp)) {
+            while (j < n && is_letter(cps[j])) j++;
+        }
+        else if (!is_number(cp)) {
+            while (j < n && !is_space(cps[j]) && !is_letter(cps[j]) && !is_number(cps[j])) j++;
+        }
+
+        bpe(lower.substr(offs[i], offs[j] - offs[i]), ids);
+        i = j;
+    }
+}
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* WordPiece (BERT)
+* @par DESCRIPTION
+*   basic tokenization (cleaning, CJK and punctuation splitting, optional
+*   lower casing with accent stripping) and the greedy longest match.
+**/
+/**************************************************************************{{{*/
+class WordPieceTokenizer : public Tokenizer {
+//LIFECYCLE:
+public:
+    WordPieceTokenizer(bool lower_case) : mLowerCase(lower_case) {}
+    bool load(const std::string& path);
+
+//ACTION:
+public:
+    virtual void encode(const std::string& text, std::vector<int32_t>& ids);
+
+protected:
+    void wordpiece(const std::string& word, std::vector<int32_t>& ids);
+
+//ATTRIBUTE:
+protected:
+    bool    mLowerCase;
+    int32_t mUnk{0};
+    std::unordered_map<std::string, int32_t> mVocab;
+};
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* load the vocabulary file: a token per line
+**/
+/**************************************************************************{{{*/
+bool
+WordPieceTokenizer::load(const std::string& path)
+{
+    std::vector<std::string> lines;
+    if (!read_lines(path, lines) || lines.empty()) {
+        return false;
+    }
+
+    mVocab.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        mVocab.emplace(lines[i], static_cast<int32_t>(i));
+    }
+
+    auto special = [this](const char* name, int32_t alt) {
+        auto it = mVocab.find(name);
+        return (it != mVocab.end()) ? it->second : alt;
+    };
+    mBos = special("[CLS]", -1);
+    mEos = special("[SEP]", -1);
+    mPad = special("[PAD]", 0);
+    mUnk = special("[UNK]", 0);
+
+    return true;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* WordPiece of a word
+**/
+/**************************************************************************{{{*/
+void
+WordPieceTokenizer::wordpiece(const std::string& word, std::vector<int32_t>& ids)
+{
+    // code point boundaries
+    std::vector<size_t> bound;
+    for (size_t pos = 0; pos < word.size();) {
+        bound.push_back(pos);
+        next_cp(word, pos);
+    }
+    bound.push_back(word.size());
+
+    const size_t n = bound.size() - 1;
+    if (n > 100) {
+        ids.push_back(mUnk);
+        return;
+    }
+
+    std::vector<int32_t> pieces;
+    for (size_t start = 0; start < n;) {
+        int32_t found = -1;
+        size_t  end   = n;
+        for (; end > start; end--) {
+            std::string piece = (start > 0 ? "##" : "") + word.substr(bound[start], bound[end] - bound[start]);
+            auto it = mVocab.find(piece);
+            if (it != mVocab.end()) {
+                found = it->second;
+                break;
+            }
+        }
+        if (found < 0) {
+            ids.push_back(mUnk);
+            return;
+        }
+        pieces.push_back(found);
+        start = end;
+    }
+
+    ids.insert(ids.end(), pieces.begin(), pieces.end());
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* encode the text
+**/
+/**************************************************************************{{{*/
+void
+WordPieceTokenizer::encode(const std::string& text, std::vector<int32_t>& ids)
+{
+    std::string word;
+    auto flush = [&]() {
+        if (!word.empty()) {
+            wordpiece(word, ids);
+            word.clear();
+        }
+    };
+
+    for (size_t pos = 0; pos < text.size();) {
+        uint32_t cp = next_cp(text, pos);
+        if (cp == 0 || cp == 0xFFFD || is_control(cp)) {
+            continue;
+        }
+        if (is_space(cp)) {
+            flush();
+            continue;
+        }
+        if (mLowerCase) {
+            cp = strip_accent(to_lower(cp));
+            if (cp >= 0x0300 && cp <= 0x036F) {
+                continue;   // combining mark
+            }
+        }
+        if (is_punct(cp) || is_cjk(cp)) {
+            flush();
+            put_cp(word, cp);
+            flush();
+            continue;
+        }
+        put_cp(word, cp);
+    }
+    flush();
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* the tokenizer given by --tokenizer
+**/
+/**************************************************************************{{{*/
+static std::unique_ptr<Tokenizer> gTokenizer;
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* load the tokenizer
+* @par DESCRIPTION
+*   spec: "clip:<merges file>", "wordpiece:<vocab file>" (uncased) or
+*   "wordpiece_cased:<vocab file>"
+*
+* @retval 0  success
+* @retval -1 unknown kind
+* @retval -2 failed to load the file
+**/
+/**************************************************************************{{{*/
+int
+load_tokenizer(const std::string& spec)
+{
+    size_t sep = spec.find(':');
+    std::string kind = spec.substr(0, sep);
+    std::string path = (sep != std::string::npos) ? spec.substr(sep + 1) : "";
+
+    if (kind == "clip") {
+        std::unique_ptr<ClipTokenizer> tokenizer(new ClipTokenizer());
+        if (!tokenizer->load(path)) {
+            return -2;
+        }
+        gTokenizer = std::move(tokenizer);
+    }
+    else if (kind == "wordpiece" || kind == "wordpiece_cased") {
+        std::unique_ptr<WordPieceTokenizer> tokenizer(new WordPieceTokenizer(kind == "wordpiece"));
+        if (!tokenizer->load(path)) {
+            return -2;
+        }
+        gTokenizer = std::move(tokenizer);
+    }
+    else {
+        return -1;
+    }
+
+    return 0;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* put ids to the integer tensor
+**/
+/**************************************************************************{{{*/
+static inline void
+put_id(TensorView& view, size_t pos, int64_t id)
+{
+    if (view.mDType == TensorSpec::DTYPE_I64) {
+        reinterpret_cast<int64_t*>(view.mData)[pos] = id;
+    }
+    else {
+        reinterpret_cast<int32_t*>(view.mData)[pos] = static_cast<int32_t>(id);
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* set texts to input tensor
+* @par DESCRIPTION
+*   input dtype 8: a batch of UTF-8 texts is tokenized into the i32/i64
+*   tensor [batch, context]. every row is <bos> tokens.. <eos> <pad>..,
+*   truncated to the context keeping <eos> at the end. the attention mask
+*   is put to the input tensor "mask" if it is >= 0.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+int
+set_input_text(TinyMLInterp* interp, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int size;
+        unsigned int index;
+        unsigned int dtype;
+        int          mask;
+        unsigned int count;
+        uint8_t      data[1];      // {len::32, text::len}..
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+    const int prms_size = sizeof(prms->size) + prms->size;
+    const int data_size = prms_size - sizeof(Prms) + sizeof(uint8_t);
+
+    if (!gTokenizer) {
+        return -3;
+    }
+
+    auto int_tensor = [interp](unsigned int index, TensorView& view) {
+        if (!interp->get_input_buffer(index, view)) {
+            return -1;
+        }
+        if ((view.mDType != TensorSpec::DTYPE_I32 && view.mDType != TensorSpec::DTYPE_I64)
+        ||  view.mShape.empty()) {
+            return -3;
+        }
+        return 0;
+    };
+
+    TensorView ids, mask;
+    int res = int_tensor(prms->index, ids);
+    if (res < 0) {
+        return res;
+    }
+    if (prms->mask >= 0) {
+        if (prms->mask >= static_cast<int>(interp->InputCount())) {
+            return -1;
+        }
+        wait_input_image(prms->mask);
+        res = int_tensor(prms->mask, mask);
+        if (res < 0) {
+            return res;
+        }
+        if (mask.count() != ids.count()) {
+            return -2;
+        }
+    }
+
+    const size_t context = static_cast<size_t>(ids.mShape.back());
+    const size_t rows    = (context > 0) ? ids.count()/context : 0;
+    if (prms->count > rows) {
+        return -2;
+    }
+
+    // texts
+    std::vector<std::string> texts;
+    const uint8_t* ptr = prms->data;
+    const uint8_t* end = prms->data + std::max(data_size, 0);
+    for (unsigned int i = 0; i < prms->count; i++) {
+        uint32_t len;
+        if (ptr + sizeof(len) > end) {
+            return -2;
+        }
+        memcpy(&len, ptr, sizeof(len));
+        ptr += sizeof(len);
+        if (len > static_cast<size_t>(end - ptr)) {
+            return -2;
+        }
+        texts.emplace_back(reinterpret_cast<const char*>(ptr), len);
+        ptr += len;
+    }
+
+    Tokenizer& tokenizer = *gTokenizer;
+    thread_pool().parallel_for(rows, [&](size_t begin, size_t last) {
+        std::vector<int32_t> tokens;
+        for (size_t r = begin; r < last; r++) {
+            tokens.clear();
+            if (r < texts.size()) {
+                if (tokenizer.mBos >= 0) {
+                    tokens.push_back(tokenizer.mBos);
+                }
+                tokenizer.encode(texts[r], tokens);
+                if (tokenizer.mEos >= 0) {
+                    tokens.push_back(tokenizer.mEos);
+                }
+                if (tokens.size() > context) {
+                    tokens.resize(context);
+                    if (tokenizer.mEos >= 0 && context > 0) {
+                        tokens.back() = tokenizer.mEos;
+                    }
+                }
+            }
+
+            for (size_t k = 0; k < context; k++) {
+                bool valid = (k < tokens.size());
+                put_id(ids, r*context + k, valid ? tokens[k] : tokenizer.mPad);
+                if (mask.mData) {
+                    put_id(mask, r*context + k, valid ? 1 : 0);
+                }
+            }
+        }
+    }, 4);
+
+    return prms_size;
+}
+
+/*** tokenizer.cpp ********************************************************}}}*/
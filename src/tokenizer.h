@@ -0,0 +1,43 @@
+/***  File Header  ************************************************************/
+/**
+* tokenizer.h
+*
+* Tiny ML pre processing libraies: text tokenizer
+* @author      Shozo Fukuda
+* @date create Mon Oct 19 19:12:08 JST 2026
+* System    Windows10, WSL2/Ubuntu 20.04.2<br>
+*
+*******************************************************************************/
+#ifndef _TOKENIZER_H
+#define _TOKENIZER_H
+
+/***  Class Header  *******************************************************}}}*/
+/**
+* tokenizer interface
+* @par DESCRIPTION
+*   encode a UTF-8 text into token ids (without the special tokens).
+**/
+/**************************************************************************{{{*/
+class Tokenizer {
+//LIFECYCLE:
+public:
+    virtual ~Tokenizer() {}
+
+//ACTION:
+public:
+    virtual void encode(const std::string& text, std::vector<int32_t>& ids) = 0;
+
+//ATTRIBUTE:
+public:
+    int32_t mBos{-1};       // put at the head if >= 0
+    int32_t mEos{-1};       // put at the tail if >= 0
+    int32_t mPad{0};
+};
+
+/**************************************************************************}}}**
+*
+***************************************************************************{{{*/
+int load_tokenizer(const std::string& spec);
+int set_input_text(TinyMLInterp* interp, const void* args);
+
+#endif /* _TOKENIZER_H */
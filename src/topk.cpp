@@ -0,0 +1,180 @@
+/***  File Header  ************************************************************/
+/**
+* topk.cpp
+*
+* Tiny ML post processing libraies: top-k classification
+* @author      Shozo Fukuda
+* @date create Tue Oct 20 09:41:26 JST 2026
+* System       Windows10, WSL2/Ubuntu20.04.2, Linux Mint<br>
+*
+**/
+/**************************************************************************{{{*/
+
+#include <math.h>
+#include <algorithm>
+
+#include "tiny_ml.h"
+#include "tensor_conv.h"
+#include "thread_pool.h"
+#include "postprocess.h"
+
+/*--- CONSTANT ---*/
+const size_t BLOCK = 64;        // block skipped by its maximum
+
+typedef std::pair<float, int> Score;    // {value, index}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* partial selection of the k largest
+* @par DESCRIPTION
+*   keep the k largest in a sorted array. a block whose maximum does not
+*   beat the k-th is skipped, so only a few elements are inspected one by
+*   one once the array is filled. ties are taken in the index order.
+*
+**/
+/**************************************************************************{{{*/
+static void
+select_topk(const float* x, size_t n, size_t k, std::vector<Score>& top)
+{
+    top.clear();
+    if (k == 0 || n == 0) {
+        return;
+    }
+
+    if (k*8 > n) {
+        // large k: partial sort of the index
+        std::vector<int> idx(n);
+        for (size_t i = 0; i < n; i++) {
+            idx[i] = static_cast<int>(i);
+        }
+        k = std::min(k, n);
+        std::partial_sort(idx.begin(), idx.begin() + k, idx.end(), [x](int a, int b) {
+            return (x[a] > x[b]) || (x[a] == x[b] && a < b);
+        });
+        for (size_t i = 0; i < k; i++) {
+            top.emplace_back(x[idx[i]], idx[i]);
+        }
+        return;
+    }
+
+    top.reserve(k + 1);
+    for (size_t base = 0; base < n; base += BLOCK) {
+        size_t len = std::min(BLOCK, n - base);
+        if (top.size() == k && max_f32(x + base, len) <= top.back().first) {
+            continue;
+        }
+
+        for (size_t i = base; i < base + len; i++) {
+            if (top.size() == k && x[i] <= top.back().first) {
+                continue;
+            }
+            auto pos = std::upper_bound(top.begin(), top.end(), x[i], [](float v, const Score& s) {
+                return v > s.first;
+            });
+            top.insert(pos, Score(x[i], static_cast<int>(i)));
+            if (top.size() > k) {
+                top.pop_back();
+            }
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* top-k of the output tensor
+* @par DESCRIPTION
+*   take the last axis of the output tensor as the class scores of every
+*   row, and reply the top-k [label, index, score] of each row.
+*   func: 0:as it is, 1:softmax, 2:sigmoid
+*
+* @retval json
+**/
+/**************************************************************************{{{*/
+std::string
+topk(SysInfo& sys, const void* args)
+{
+    PACK(
+    struct Prms {
+        unsigned int index;
+        unsigned int k;
+        unsigned int func;
+        float        threshold;
+    });
+    const Prms*  prms = reinterpret_cast<const Prms*>(args);
+
+    json res;
+
+    TensorView view;
+    if (prms->index >= sys.mInterp->OutputCount() || !sys.mInterp->get_output_buffer(prms->index, view)) {
+        res["status"] = -1;
+        return res.dump();
+    }
+    if ((view.mDType != TensorSpec::DTYPE_F32 && view.mDType != TensorSpec::DTYPE_F16)
+    ||  view.mShape.empty() || view.mShape.back() <= 0) {
+        res["status"] = -3;
+        return res.dump();
+    }
+
+    const size_t classes = static_cast<size_t>(view.mShape.back());
+    const size_t rows    = view.count()/classes;
+    const bool   is_f16  = (view.mDType == TensorSpec::DTYPE_F16);
+
+    std::vector<std::vector<Score>> result(rows);
+    thread_pool().parallel_for(rows, [&](size_t begin, size_t end) {
+        std::vector<float> wide(is_f16 ? classes : 0);
+        for (size_t r = begin; r < end; r++) {
+            const float* x;
+            if (is_f16) {
+                f16_to_f32(wide.data(), reinterpret_cast<const uint8_t*>(view.mData) + 2*r*classes, classes);
+                x = wide.data();
+            }
+            else {
+                x = reinterpret_cast<const float*>(view.mData) + r*classes;
+            }
+
+            std::vector<Score>& top = result[r];
+            select_topk(x, classes, prms->k, top);
+            if (top.empty()) {
+                continue;
+            }
+
+            // activation is monotonic: apply it to the selected ones only.
+            if (prms->func == 1) {
+                float  m   = top[0].first;
+                double sum = 0.0;
+                for (size_t i = 0; i < classes; i++) {
+                    sum += exp(x[i] - m);
+                }
+                for (auto& s : top) {
+                    s.first = static_cast<float>(exp(s.first - m)/sum);
+                }
+            }
+            else if (prms->func == 2) {
+                for (auto& s : top) {
+                    s.first = 1.0f/(1.0f + expf(-s.first));
+                }
+            }
+
+            auto cut = std::find_if(top.begin(), top.end(), [prms](const Score& s) {
+                return s.first < prms->threshold;
+            });
+            top.erase(cut, top.end());
+        }
+    }, 8);
+
+    res["status"] = 0;
+    res["topk"]   = json::array();
+    for (const auto& top : result) {
+        json row = json::array();
+        for (const auto& s : top) {
+            row.push_back({ sys.label(s.second), s.second, s.first });
+        }
+        res["topk"].push_back(row);
+    }
+
+    sys.LAP_OUTPUT();
+
+    return res.dump();
+}
+
+/*** topk.cpp *************************************************************}}}*/
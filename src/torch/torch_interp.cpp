@@ -11,9 +11,119 @@
 /**************************************************************************{{{*/
 
 #include <torch/script.h>
+#include <algorithm>
 #include "../tensor_spec.h"
 #include "torch_interp.h"
 
+/***  Module Header  ******************************************************}}}*/
+/**
+* convert dtype of TensorSpec to torch scalar type
+* @par DESCRIPTION
+*
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+static torch::Dtype
+to_torch_dtype(TensorSpec::DType dtype)
+{
+    switch (dtype) {
+    case TensorSpec::DTYPE_U8:  return torch::kUInt8;
+    case TensorSpec::DTYPE_I8:  return torch::kInt8;
+    case TensorSpec::DTYPE_I16: return torch::kInt16;
+    case TensorSpec::DTYPE_I32: return torch::kInt32;
+    case TensorSpec::DTYPE_I64: return torch::kInt64;
+    case TensorSpec::DTYPE_F16: return torch::kHalf;
+    case TensorSpec::DTYPE_F32:
+    default:                    return torch::kFloat32;
+    }
+}
+
+static TensorSpec::DType
+from_torch_dtype(at::ScalarType type)
+{
+    switch (type) {
+    case torch::kFloat32: return TensorSpec::DTYPE_F32;
+    case torch::kUInt8:   return TensorSpec::DTYPE_U8;
+    case torch::kInt8:    return TensorSpec::DTYPE_I8;
+    case torch::kInt16:   return TensorSpec::DTYPE_I16;
+    case torch::kInt32:   return TensorSpec::DTYPE_I32;
+    case torch::kInt64:   return TensorSpec::DTYPE_I64;
+    case torch::kHalf:    return TensorSpec::DTYPE_F16;
+    default:              return TensorSpec::DTYPE_NONE;
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* flatten the output IValue
+* @par DESCRIPTION
+*   walk through the nested tuple/list/dict and collect the tensors in order.
+*
+**/
+/**************************************************************************{{{*/
+static void
+flatten_ivalue(const torch::jit::IValue& value, std::vector<at::Tensor>& tensors)
+{
+    if (value.isTensor()) {
+        tensors.push_back(value.toTensor());
+    }
+    else if (value.isTuple()) {
+        for (const auto& item : value.toTupleRef().elements()) {
+            flatten_ivalue(item, tensors);
+        }
+    }
+    else if (value.isList()) {
+        for (const auto& item : value.toListRef()) {
+            flatten_ivalue(item, tensors);
+        }
+    }
+    else if (value.isGenericDict()) {
+        for (const auto& item : value.toGenericDict()) {
+            flatten_ivalue(item.value(), tensors);
+        }
+    }
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* split tensor specs into the methods
+* @par DESCRIPTION
+*   "name=spec:spec;name=spec:.." -> {{name, "spec:spec"}, ..}
+*   the name can be omitted, then it is "forward".
+**/
+/**************************************************************************{{{*/
+static std::vector<std::pair<std::string, std::string>>
+split_method_specs(const std::string& specs)
+{
+    std::vector<std::pair<std::string, std::string>> method_specs;
+
+    if (specs.empty()) {
+        return method_specs;
+    }
+
+    auto offset = std::string::size_type(0);
+    for (;;) {
+        auto pos = specs.find(';', offset);
+        std::string chunk = specs.substr(offset, (pos == std::string::npos) ? pos : pos - offset);
+
+        auto eq = chunk.find('=');
+        if (eq == std::string::npos) {
+            method_specs.emplace_back("forward", chunk);
+        }
+        else {
+            method_specs.emplace_back(chunk.substr(0, eq), chunk.substr(eq + 1));
+        }
+
+        if (pos == std::string::npos) {
+            break;
+        }
+        offset = pos + 1;
+    }
+
+    return method_specs;
+}
+
 /***  Module Header  ******************************************************}}}*/
 /**
 * initialize interpreter
@@ -50,11 +160,24 @@ TorchInterp::TorchInterp(std::string& model, std::string& inputs, std::string& o
 
 	//std::cout << "Model loaded successfully\n";
 
-    mInputSpec = parse_tensor_spec(inputs, true);
-    mInputCount = mInputSpec.size();
+    for (auto& item : split_method_specs(inputs)) {
+        add_method(item.first).mInputSpec = parse_tensor_spec(item.second, true);
+    }
+    for (auto& item : split_method_specs(outputs)) {
+        add_method(item.first).mOutputSpec = parse_tensor_spec(item.second);
+    }
+    if (mMethod.empty()) {
+        add_method("forward");
+    }
+
+    for (const auto& method : mMethod) {
+        if (!mModule.find_method(method.mName)) {
+            std::cerr << "error: unknown method \"" << method.mName << "\"\n";
+            exit(1);
+        }
+    }
 
-    mOutputSpec = parse_tensor_spec(outputs);
-    mOutputCount = mOutputSpec.size();
+    select_method(mMethod[0].mName);
 }
 
 /***  Method Header  ******************************************************}}}*/
@@ -66,11 +189,63 @@ TorchInterp::TorchInterp(std::string& model, std::string& inputs, std::string& o
 /**************************************************************************{{{*/
 TorchInterp::~TorchInterp()
 {
-    for (auto item : mInputSpec) { delete item; }
-    mInputSpec.clear();
+    for (auto& method : mMethod) {
+        for (auto item : method.mInputSpec) { delete item; }
+        method.mInputSpec.clear();
+
+        for (auto item : method.mOutputSpec) { delete item; }
+        method.mOutputSpec.clear();
+    }
+}
+
+/***  Method Header  ******************************************************}}}*/
+/**
+* add the method
+* @par DESCRIPTION
+*   return the method entry named "name", create it if not exists.
+**/
+/**************************************************************************{{{*/
+TorchInterp::TorchMethod&
+TorchInterp::add_method(const std::string& name)
+{
+    for (auto& method : mMethod) {
+        if (method.mName == name) {
+            return method;
+        }
+    }
 
-    for (auto item : mOutputSpec) { delete item; }
-    mOutputSpec.clear();
+    mMethod.emplace_back();
+    mMethod.back().mName = name;
+    return mMethod.back();
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* select the method
+* @par DESCRIPTION
+*   switch the method to which set_input_tensor/invoke/get_output_tensor
+*   are applied. empty name selects the first method.
+*
+* @retval 0  success
+* @retval -1 unknown method
+**/
+/**************************************************************************{{{*/
+int
+TorchInterp::select_method(const std::string& name)
+{
+    for (size_t i = 0; i < mMethod.size(); i++) {
+        if (name.empty() || mMethod[i].mName == name) {
+            if (i != mCurrent) {
+                mOutput.clear();
+            }
+            mCurrent     = i;
+            mInputCount  = mMethod[i].mInputSpec.size();
+            mOutputCount = mMethod[i].mOutputSpec.size();
+            return 0;
+        }
+    }
+
+    return -1;
 }
 
 /***  Module Header  ******************************************************}}}*/
@@ -105,27 +280,44 @@ TorchInterp::info(json& res)
         "BFLOAT16"      // Non-IEEE floating-point format based on IEEE754 single-precision
     };
 
+    const TorchMethod& method = mMethod[mCurrent];
+
     res["framework"] = "LibTorch";
+    res["method"]    = method.mName;
+    for (const auto& item : mMethod) {
+        res["methods"].push_back(item.mName);
+    }
 
     for (int index = 0; index < mInputCount; index++) {
         json json_tensor;
 
         json_tensor["index"] = index;
-        json_tensor["type"]  = _dtype[mInputSpec[index]->mDType];
-        for (const auto& n : mInputSpec[index]->mShape) {
+        json_tensor["type"]  = _dtype[method.mInputSpec[index]->mDType];
+        for (const auto& n : method.mInputSpec[index]->mShape) {
             json_tensor["dims"].push_back(n);
         }
 
         res["inputs"].push_back(json_tensor);
     }
 
-    for (int index = 0; index < mOutputCount; index++) {
+    // the outputs beyond the spec are described by the last invoke.
+    const size_t num_output = std::max(method.mOutputSpec.size(), mOutput.size());
+    for (size_t index = 0; index < num_output; index++) {
         json json_tensor;
 
         json_tensor["index"] = index;
-        json_tensor["type"]  = _dtype[mOutputSpec[index]->mDType];
-        for (const auto& n : mOutputSpec[index]->mShape) {
-            json_tensor["dims"].push_back(n);
+        if (index < method.mOutputSpec.size()) {
+            json_tensor["type"] = _dtype[method.mOutputSpec[index]->mDType];
+            for (const auto& n : method.mOutputSpec[index]->mShape) {
+                json_tensor["dims"].push_back(n);
+            }
+        }
+        else {
+            const at::Tensor& t = mOutput[index];
+            json_tensor["type"] = _dtype[from_torch_dtype(t.scalar_type())];
+            for (const auto& n : t.sizes()) {
+                json_tensor["dims"].push_back(n);
+            }
         }
 
         res["outputs"].push_back(json_tensor);
@@ -144,84 +336,147 @@ TorchInterp::info(json& res)
 int
 TorchInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size)
 {
-    memcpy(mInputSpec[index]->mBlob, data, size);
+    memcpy(mMethod[mCurrent].mInputSpec[index]->mBlob, data, size);
     return size;
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* set input tensor
+* execute inference
 * @par DESCRIPTION
 *
-*
 * @retval
 **/
 /**************************************************************************{{{*/
-int
-TorchInterp::set_input_tensor(unsigned int index, const uint8_t* data, int size, std::function<float(uint8_t)> conv)
+bool
+TorchInterp::invoke()
 {
-    float* dst = reinterpret_cast<float*>(mInputSpec[index]->mBlob);
+    const TorchMethod& method = mMethod[mCurrent];
+    std::vector<torch::jit::IValue> inputs;
+
+    for (const auto blob : method.mInputSpec) {
+        auto options = torch::TensorOptions().dtype(to_torch_dtype(blob->mDType));
 
-    const uint8_t* src = data;
-    for (int i = 0; i < size; i++) {
-        *dst++ = conv(*src++);
+        inputs.push_back(torch::from_blob(blob->mBlob, c10::IntArrayRef(blob->mShape), options));
     }
 
-    return size;
+    torch::jit::IValue output = mModule.get_method(method.mName)(inputs);
+
+    // flatten the outputs into contiguous tensors once per invoke.
+    mOutput.clear();
+    flatten_ivalue(output, mOutput);
+    for (size_t index = 0; index < mOutput.size(); index++) {
+        at::Tensor& t = mOutput[index];
+        if (index < method.mOutputSpec.size()
+        &&  method.mOutputSpec[index]->mDType != TensorSpec::DTYPE_NONE
+        &&  method.mOutputSpec[index]->mDType != TensorSpec::DTYPE_U32) {
+            t = t.to(to_torch_dtype(method.mOutputSpec[index]->mDType));
+        }
+        t = t.contiguous();
+    }
+    mOutputCount = mOutput.size();
+
+    return true;
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* execute inference
+* get result tensor
+* @par DESCRIPTION
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+std::string
+TorchInterp::get_output_tensor(unsigned int index)
+{
+    if (index >= mOutput.size()) {
+        return "";
+    }
+
+    const at::Tensor& t = mOutput[index];
+    return std::string(reinterpret_cast<char*>(t.data_ptr()), t.nbytes());
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* get raw buffer of input tensor
 * @par DESCRIPTION
 *
 * @retval
 **/
 /**************************************************************************{{{*/
 bool
-TorchInterp::invoke()
+TorchInterp::get_input_buffer(unsigned int index, TensorView& view)
 {
-    std::vector<torch::jit::IValue> inputs;
+    const TensorSpec* spec = mMethod[mCurrent].mInputSpec[index];
 
-    for (const auto blob : mInputSpec) {
-        auto options = torch::TensorOptions().dtype(
-            (blob->mDType == TensorSpec::DTYPE_F32) ? torch::kFloat32 :
-            (blob->mDType == TensorSpec::DTYPE_U8)  ? torch::kUInt8   :
-            (blob->mDType == TensorSpec::DTYPE_I8)  ? torch::kInt8    :
-            (blob->mDType == TensorSpec::DTYPE_I16) ? torch::kInt16   :
-            (blob->mDType == TensorSpec::DTYPE_I32) ? torch::kInt32   :
-            torch::kFloat32
-        );
+    view.mData  = spec->mBlob;
+    view.mDType = spec->mDType;
+    view.mShape = spec->mShape;
+    view.mBytes = view.count() * dtype_size(spec->mDType);
 
-        inputs.push_back(torch::from_blob(blob->mBlob, c10::IntArrayRef(blob->mShape), options));
+    return true;
+}
+
+/***  Module Header  ******************************************************}}}*/
+/**
+* get raw buffer of output tensor
+* @par DESCRIPTION
+*   valid until the next invoke.
+*
+* @retval
+**/
+/**************************************************************************{{{*/
+bool
+TorchInterp::get_output_buffer(unsigned int index, TensorView& view)
+{
+    if (index >= mOutput.size()) {
+        return false;
     }
 
-    mOutput = mModule.forward(inputs);
+    const at::Tensor& t = mOutput[index];
+
+    view.mData  = t.data_ptr();
+    view.mBytes = t.nbytes();
+    view.mDType = from_torch_dtype(t.scalar_type());
+    view.mShape.assign(t.sizes().begin(), t.sizes().end());
 
     return true;
 }
 
 /***  Module Header  ******************************************************}}}*/
 /**
-* get result tensor
+* resize input tensor
 * @par DESCRIPTION
+*   re-allocate the blob of the input tensor in the shape. the contents
+*   are undefined.
 *
 * @retval
 **/
 /**************************************************************************{{{*/
-std::string
-TorchInterp::get_output_tensor(unsigned int index)
+bool
+TorchInterp::resize_input_tensor(unsigned int index, const std::vector<int64_t>& shape)
 {
-    if (mOutput.isTuple()) {
-        return "";
+    if (index >= mInputCount) {
+        return false;
     }
-    else if (mOutput.isTensor()) {
-        at::Tensor t = mOutput.toTensor();
-        return std::string(reinterpret_cast<char*>(t.data_ptr()), t.nbytes());
+
+    TensorSpec* spec = mMethod[mCurrent].mInputSpec[index];
+    if (spec->mShape == shape) {
+        return true;
     }
-    else {
-        return "";
+
+    TensorView before, after;
+    before.mShape = spec->mShape;
+    after.mShape  = shape;
+    if (after.count() != before.count()) {
+        delete [] spec->mBlob;
+        spec->mBlob = new uint8_t[std::max<size_t>(after.count(), 1) * dtype_size(spec->mDType)];
     }
+    spec->mShape = shape;
+
+    return true;
 }
 
 /*** torch_interp.cpp *****************************************************}}}*/
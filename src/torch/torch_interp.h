@@ -35,6 +35,14 @@ friend class TorchInterpTest;
 //CONSTANT:
 public:
 
+//TYPE:
+private:
+    struct TorchMethod {
+        std::string              mName;
+        std::vector<TensorSpec*> mInputSpec;
+        std::vector<TensorSpec*> mOutputSpec;
+    };
+
 //LIFECYCLE:
 public:
     TorchInterp(std::string onnx_model);
@@ -45,9 +53,12 @@ public:
 public:
     void info(json& res);
     int set_input_tensor(unsigned int index, const uint8_t* data, int size);
-    int set_input_tensor(unsigned int index, const uint8_t* data, int size, std::function<float(uint8_t)> conv);
     bool invoke();
     std::string get_output_tensor(unsigned int index);
+    bool get_input_buffer(unsigned int index, TensorView& view);
+    bool get_output_buffer(unsigned int index, TensorView& view);
+    bool resize_input_tensor(unsigned int index, const std::vector<int64_t>& shape);
+    int select_method(const std::string& name);
 
 //ACCESSOR:
 public:
@@ -55,14 +66,18 @@ public:
 //INQUIRY:
 public:
 
+//IMPLEMENTATION:
+private:
+    TorchMethod& add_method(const std::string& name);
+
 //ATTRIBUTE:
 private:
     torch::jit::script::Module mModule;
 
-    std::vector<TensorSpec*> mInputSpec;
-    std::vector<TensorSpec*> mOutputSpec;
+    std::vector<TorchMethod> mMethod;
+    size_t                   mCurrent{0};
 
-    torch::jit::IValue mOutput;
+    std::vector<at::Tensor> mOutput;
 };
 
 /*INLINE METHOD: